@@ -27,6 +27,7 @@
 #include "render/pixel_format.h"
 #include "render/swapchain.h"
 #include "util/signal.h"
+#include "util/trace.h"
 
 bool check_drm_features(struct wlr_drm_backend *drm) {
 	uint64_t cap;
@@ -1459,6 +1460,8 @@ static void page_flip_handler(int fd, unsigned seq,
 
 	conn->pending_page_flip_crtc = 0;
 
+	trace_instant("drm_page_flip", "seq", seq);
+
 	if (conn->state != WLR_DRM_CONN_CONNECTED || conn->crtc == NULL) {
 		wlr_drm_conn_log(conn, WLR_DEBUG,
 			"Ignoring page-flip event for disabled connector");
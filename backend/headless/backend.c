@@ -11,7 +11,7 @@
 #include <xf86drm.h>
 #include "backend/headless.h"
 #include "render/drm_format_set.h"
-#include "render/gbm_allocator.h"
+#include "render/allocator.h"
 #include "render/wlr_renderer.h"
 #include "util/signal.h"
 
@@ -28,7 +28,7 @@ static bool backend_start(struct wlr_backend *wlr_backend) {
 
 	struct wlr_headless_output *output;
 	wl_list_for_each(output, &backend->outputs, link) {
-		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+		headless_output_start_clock(output);
 		wlr_output_update_enabled(&output->wlr_output, true);
 		wlr_signal_emit_safe(&backend->backend.events.new_output,
 			&output->wlr_output);
@@ -75,7 +75,9 @@ static void backend_destroy(struct wlr_backend *wlr_backend) {
 	}
 
 	wlr_allocator_destroy(backend->allocator);
-	close(backend->drm_fd);
+	if (backend->drm_fd >= 0) {
+		close(backend->drm_fd);
+	}
 	free(backend);
 }
 
@@ -112,15 +114,12 @@ static void handle_renderer_destroy(struct wl_listener *listener, void *data) {
 }
 
 static bool backend_init(struct wlr_headless_backend *backend,
-		struct wl_display *display, struct wlr_allocator *allocator,
-		struct wlr_renderer *renderer) {
+		struct wl_display *display, struct wlr_renderer *renderer) {
 	wlr_backend_init(&backend->backend, &backend_impl);
 	backend->display = display;
 	wl_list_init(&backend->outputs);
 	wl_list_init(&backend->input_devices);
 
-	backend->allocator = allocator;
-
 	if (renderer == NULL) {
 		renderer = wlr_renderer_autocreate(&backend->backend);
 		if (!renderer) {
@@ -130,10 +129,17 @@ static bool backend_init(struct wlr_headless_backend *backend,
 	}
 	backend->renderer = renderer;
 
+	backend->allocator =
+		allocator_autocreate_with_drm_fd(backend->renderer, backend->drm_fd);
+	if (backend->allocator == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create allocator");
+		return false;
+	}
+
 	const struct wlr_drm_format_set *formats =
-		wlr_renderer_get_dmabuf_render_formats(backend->renderer);
+		wlr_renderer_get_render_formats(backend->renderer);
 	if (formats == NULL) {
-		wlr_log(WLR_ERROR, "Failed to get available DMA-BUF formats from renderer");
+		wlr_log(WLR_ERROR, "Failed to get available render formats from renderer");
 		return false;
 	}
 	const struct wlr_drm_format *format =
@@ -186,7 +192,7 @@ static int open_drm_render_node(void) {
 		}
 	}
 	if (fd < 0) {
-		wlr_log(WLR_ERROR, "Failed to find any DRM render node");
+		wlr_log(WLR_DEBUG, "Failed to find any DRM render node");
 	}
 
 out:
@@ -208,36 +214,28 @@ struct wlr_backend *wlr_headless_backend_create(struct wl_display *display) {
 		return NULL;
 	}
 
+	// Without a DRM render node, fall back to software rendering into
+	// shared memory buffers
 	backend->drm_fd = open_drm_render_node();
 	if (backend->drm_fd < 0) {
-		wlr_log(WLR_ERROR, "Failed to open DRM render node");
-		goto error_drm_fd;
+		wlr_log(WLR_INFO, "Failed to open DRM render node, "
+			"falling back to shared memory buffers");
 	}
 
-	int drm_fd = fcntl(backend->drm_fd, F_DUPFD_CLOEXEC, 0);
-	if (drm_fd < 0) {
-		wlr_log_errno(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
-		goto error_dup;
-	}
-
-	struct wlr_gbm_allocator *gbm_alloc = wlr_gbm_allocator_create(drm_fd);
-	if (gbm_alloc == NULL) {
-		wlr_log(WLR_ERROR, "Failed to create GBM allocator");
-		close(drm_fd);
-		goto error_dup;
-	}
-
-	if (!backend_init(backend, display, &gbm_alloc->base, NULL)) {
+	if (!backend_init(backend, display, NULL)) {
 		goto error_init;
 	}
 
 	return &backend->backend;
 
 error_init:
-	wlr_allocator_destroy(&gbm_alloc->base);
-error_dup:
-	close(backend->drm_fd);
-error_drm_fd:
+	if (backend->renderer != NULL) {
+		wlr_renderer_destroy(backend->renderer);
+	}
+	wlr_allocator_destroy(backend->allocator);
+	if (backend->drm_fd >= 0) {
+		close(backend->drm_fd);
+	}
 	free(backend);
 	return NULL;
 }
@@ -254,26 +252,18 @@ struct wlr_backend *wlr_headless_backend_create_with_renderer(
 	}
 	backend->has_parent_renderer = true;
 
-	backend->drm_fd = wlr_renderer_get_drm_fd(renderer);
-	if (backend->drm_fd < 0) {
-		wlr_log(WLR_ERROR, "Failed to get DRM device FD from renderer");
-		goto error_drm_fd;
-	}
-
-	int drm_fd = fcntl(backend->drm_fd, F_DUPFD_CLOEXEC, 0);
-	if (drm_fd < 0) {
-		wlr_log_errno(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
-		goto error_dup;
-	}
-
-	struct wlr_gbm_allocator *gbm_alloc = wlr_gbm_allocator_create(drm_fd);
-	if (gbm_alloc == NULL) {
-		wlr_log(WLR_ERROR, "Failed to create GBM allocator");
-		close(drm_fd);
-		goto error_dup;
+	// Software renderers don't have a DRM device FD
+	backend->drm_fd = -1;
+	int renderer_drm_fd = wlr_renderer_get_drm_fd(renderer);
+	if (renderer_drm_fd >= 0) {
+		backend->drm_fd = fcntl(renderer_drm_fd, F_DUPFD_CLOEXEC, 0);
+		if (backend->drm_fd < 0) {
+			wlr_log_errno(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
+			goto error_dup;
+		}
 	}
 
-	if (!backend_init(backend, display, &gbm_alloc->base, renderer)) {
+	if (!backend_init(backend, display, renderer)) {
 		goto error_init;
 	}
 
@@ -283,10 +273,11 @@ struct wlr_backend *wlr_headless_backend_create_with_renderer(
 	return &backend->backend;
 
 error_init:
-	wlr_allocator_destroy(&gbm_alloc->base);
+	wlr_allocator_destroy(backend->allocator);
+	if (backend->drm_fd >= 0) {
+		close(backend->drm_fd);
+	}
 error_dup:
-	close(backend->drm_fd);
-error_drm_fd:
 	free(backend);
 	return NULL;
 }
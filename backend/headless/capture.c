@@ -0,0 +1,167 @@
+#define _POSIX_C_SOURCE 200809L
+#include <assert.h>
+#include <drm_fourcc.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/util/log.h>
+#include "backend/headless.h"
+#include "render/wlr_renderer.h"
+#include "util/time.h"
+
+static bool write_all(int fd, const void *data, size_t size) {
+	const char *ptr = data;
+	while (size > 0) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return false;
+		}
+		ptr += n;
+		size -= n;
+	}
+	return true;
+}
+
+static void output_stop_capture(struct wlr_headless_output *output) {
+	if (output->capture_fd >= 0) {
+		close(output->capture_fd);
+	}
+	output->capture_fd = -1;
+	output->capture_pending = false;
+	free(output->capture_pixels);
+	output->capture_pixels = NULL;
+	free(output->capture_frame);
+	output->capture_frame = NULL;
+}
+
+/**
+ * Convert XRGB8888 pixels to planar BT.601 limited-range YUV 4:4:4.
+ */
+static void convert_to_yuv444(uint8_t *dst, const uint32_t *src,
+		size_t len) {
+	uint8_t *y_plane = dst;
+	uint8_t *u_plane = dst + len;
+	uint8_t *v_plane = dst + 2 * len;
+	for (size_t i = 0; i < len; i++) {
+		int r = (src[i] >> 16) & 0xFF;
+		int g = (src[i] >> 8) & 0xFF;
+		int b = src[i] & 0xFF;
+		y_plane[i] = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16;
+		u_plane[i] = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128;
+		v_plane[i] = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128;
+	}
+}
+
+void headless_output_capture_buffer(struct wlr_headless_output *output,
+		struct wlr_buffer *buffer) {
+	struct wlr_output *wlr_output = &output->wlr_output;
+	if (output->capture_fd < 0) {
+		return;
+	}
+
+	output->capture_pending = false;
+
+	if (output->capture_damaged_only &&
+			(wlr_output->pending.committed & WLR_OUTPUT_STATE_DAMAGE) &&
+			!pixman_region32_not_empty(&wlr_output->pending.damage)) {
+		return;
+	}
+
+	if (buffer->width != output->capture_width ||
+			buffer->height != output->capture_height) {
+		wlr_log(WLR_ERROR, "Output %s size changed, stopping capture",
+			wlr_output->name);
+		output_stop_capture(output);
+		return;
+	}
+
+	struct wlr_renderer *renderer = output->backend->renderer;
+	if (!wlr_renderer_bind_buffer(renderer, buffer)) {
+		wlr_log(WLR_ERROR, "Failed to bind buffer for capture");
+		return;
+	}
+	bool ok = wlr_renderer_read_pixels(renderer, DRM_FORMAT_XRGB8888, NULL,
+		buffer->width * 4, buffer->width, buffer->height, 0, 0, 0, 0,
+		output->capture_pixels);
+	wlr_renderer_bind_buffer(renderer, NULL);
+	if (!ok) {
+		wlr_log(WLR_ERROR, "Failed to read pixels for capture");
+		return;
+	}
+
+	convert_to_yuv444(output->capture_frame, output->capture_pixels,
+		(size_t)buffer->width * buffer->height);
+	output->capture_pending = true;
+}
+
+void headless_output_capture_present(struct wlr_headless_output *output,
+		const struct timespec *when) {
+	if (!output->capture_pending) {
+		return;
+	}
+	output->capture_pending = false;
+
+	// Frames are tagged with their presentation time, so that dropped frames
+	// can be spotted
+	char header[64];
+	int header_len = snprintf(header, sizeof(header),
+		"FRAME Xts=%" PRId64 "\n", timespec_to_nsec(when));
+	size_t frame_len =
+		(size_t)output->capture_width * output->capture_height * 3;
+	if (!write_all(output->capture_fd, header, header_len) ||
+			!write_all(output->capture_fd, output->capture_frame, frame_len)) {
+		wlr_log_errno(WLR_ERROR, "Failed to write captured frame of output %s",
+			output->wlr_output.name);
+		output_stop_capture(output);
+	}
+}
+
+void headless_output_finish_capture(struct wlr_headless_output *output) {
+	output_stop_capture(output);
+}
+
+bool wlr_headless_output_set_capture(struct wlr_output *wlr_output, int fd,
+		bool damaged_only) {
+	assert(wlr_output_is_headless(wlr_output));
+	struct wlr_headless_output *output =
+		(struct wlr_headless_output *)wlr_output;
+
+	output_stop_capture(output);
+	if (fd < 0) {
+		return true;
+	}
+
+	int width = wlr_output->width, height = wlr_output->height;
+	output->capture_pixels = calloc((size_t)width * height, 4);
+	output->capture_frame = calloc((size_t)width * height, 3);
+	if (output->capture_pixels == NULL || output->capture_frame == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		goto error;
+	}
+
+	char header[128];
+	int header_len = snprintf(header, sizeof(header),
+		"YUV4MPEG2 W%d H%d F%" PRId32 ":1000 Ip A1:1 C444\n",
+		width, height, wlr_output->refresh);
+	if (!write_all(fd, header, header_len)) {
+		wlr_log_errno(WLR_ERROR, "Failed to write capture header");
+		goto error;
+	}
+
+	output->capture_fd = fd;
+	output->capture_width = width;
+	output->capture_height = height;
+	output->capture_damaged_only = damaged_only;
+	return true;
+
+error:
+	close(fd);
+	output_stop_capture(output);
+	return false;
+}
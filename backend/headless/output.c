@@ -1,6 +1,8 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <time.h>
 #include <wlr/interfaces/wlr_output.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/util/log.h>
@@ -8,6 +10,7 @@
 #include "render/swapchain.h"
 #include "render/wlr_renderer.h"
 #include "util/signal.h"
+#include "util/time.h"
 
 static struct wlr_headless_output *headless_output_from_output(
 		struct wlr_output *wlr_output) {
@@ -24,13 +27,7 @@ static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
 		refresh = HEADLESS_DEFAULT_REFRESH;
 	}
 
-	wlr_swapchain_destroy(output->swapchain);
-	output->swapchain = wlr_swapchain_create(output->backend->allocator,
-			width, height, output->backend->format);
-	if (!output->swapchain) {
-		wlr_output_destroy(wlr_output);
-		return false;
-	}
+	wlr_swapchain_resize(output->swapchain, width, height);
 
 	output->frame_delay = 1000000 / refresh;
 
@@ -38,6 +35,54 @@ static bool output_set_custom_mode(struct wlr_output *wlr_output, int32_t width,
 	return true;
 }
 
+static int64_t output_get_refresh_period_ns(
+		struct wlr_headless_output *output) {
+	return 1000000000000 / output->wlr_output.refresh;
+}
+
+/**
+ * Simulate a refresh at the virtual time `when_ns`, presenting the last
+ * committed buffer if any.
+ */
+static void output_handle_virtual_vblank(struct wlr_headless_output *output,
+		int64_t when_ns) {
+	output->vblank_seq++;
+
+	if (!output->present_pending) {
+		return;
+	}
+	output->present_pending = false;
+
+	struct timespec when;
+	timespec_from_nsec(&when, when_ns);
+	struct wlr_output_event_present event = {
+		.commit_seq = output->present_commit_seq,
+		.when = &when,
+		.seq = output->vblank_seq,
+		.refresh = output_get_refresh_period_ns(output),
+		.flags = WLR_OUTPUT_PRESENT_VSYNC,
+	};
+	wlr_output_send_present(&output->wlr_output, &event);
+
+	headless_output_capture_present(output, &when);
+}
+
+static void output_handle_idle_frame(void *data) {
+	struct wlr_headless_output *output = data;
+	output->idle_frame = NULL;
+	wlr_output_send_frame(&output->wlr_output);
+}
+
+static void output_schedule_idle_frame(struct wlr_headless_output *output) {
+	if (output->idle_frame != NULL) {
+		return;
+	}
+	struct wl_event_loop *ev =
+		wl_display_get_event_loop(output->backend->display);
+	output->idle_frame =
+		wl_event_loop_add_idle(ev, output_handle_idle_frame, output);
+}
+
 static bool output_attach_render(struct wlr_output *wlr_output,
 		int *buffer_age) {
 	struct wlr_headless_output *output =
@@ -106,12 +151,39 @@ static bool output_commit(struct wlr_output *wlr_output) {
 		}
 		assert(buffer != NULL);
 
+		headless_output_capture_buffer(output, buffer);
+
 		wlr_buffer_unlock(output->front_buffer);
 		output->front_buffer = buffer;
 
 		wlr_swapchain_set_buffer_submitted(output->swapchain, buffer);
 
-		wlr_output_send_present(wlr_output, NULL);
+		// The commit sequence number is incremented after this function
+		output->present_commit_seq = wlr_output->commit_seq + 1;
+		switch (output->backend->clock_mode) {
+		case WLR_HEADLESS_CLOCK_REALTIME:;
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			wlr_output_send_present(wlr_output, NULL);
+			headless_output_capture_present(output, &now);
+			break;
+		case WLR_HEADLESS_CLOCK_MANUAL:
+			output->present_pending = true;
+			break;
+		case WLR_HEADLESS_CLOCK_UNTHROTTLED:
+			// Present right away at the next virtual refresh, frame events
+			// can't be sent from within a commit
+			output->present_pending = true;
+			output_handle_virtual_vblank(output, output->next_vblank_ns);
+			// Keep the virtual clock in step, so that switching to another
+			// clock mode doesn't send timestamps back in time
+			if (output->next_vblank_ns > output->backend->clock_ns) {
+				output->backend->clock_ns = output->next_vblank_ns;
+			}
+			output->next_vblank_ns += output_get_refresh_period_ns(output);
+			output_schedule_idle_frame(output);
+			break;
+		}
 	}
 
 	return true;
@@ -149,6 +221,10 @@ static void output_destroy(struct wlr_output *wlr_output) {
 		headless_output_from_output(wlr_output);
 	wl_list_remove(&output->link);
 	wl_event_source_remove(output->frame_timer);
+	if (output->idle_frame != NULL) {
+		wl_event_source_remove(output->idle_frame);
+	}
+	headless_output_finish_capture(output);
 	wlr_swapchain_destroy(output->swapchain);
 	wlr_buffer_unlock(output->back_buffer);
 	wlr_buffer_unlock(output->front_buffer);
@@ -174,6 +250,94 @@ static int signal_frame(void *data) {
 	return 0;
 }
 
+void headless_output_start_clock(struct wlr_headless_output *output) {
+	struct wlr_headless_backend *backend = output->backend;
+
+	switch (backend->clock_mode) {
+	case WLR_HEADLESS_CLOCK_REALTIME:
+		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+		break;
+	case WLR_HEADLESS_CLOCK_MANUAL:
+		wl_event_source_timer_update(output->frame_timer, 0);
+		output->next_vblank_ns =
+			backend->clock_ns + output_get_refresh_period_ns(output);
+		break;
+	case WLR_HEADLESS_CLOCK_UNTHROTTLED:
+		wl_event_source_timer_update(output->frame_timer, 0);
+		output->next_vblank_ns =
+			backend->clock_ns + output_get_refresh_period_ns(output);
+		output_schedule_idle_frame(output);
+		break;
+	}
+}
+
+void wlr_headless_backend_set_clock_mode(struct wlr_backend *wlr_backend,
+		enum wlr_headless_clock_mode mode) {
+	struct wlr_headless_backend *backend =
+		headless_backend_from_backend(wlr_backend);
+
+	enum wlr_headless_clock_mode prev_mode = backend->clock_mode;
+	if (backend->clock_mode == WLR_HEADLESS_CLOCK_REALTIME &&
+			mode != WLR_HEADLESS_CLOCK_REALTIME) {
+		// Start the virtual clock from the current time, so that timestamps
+		// stay comparable to CLOCK_MONOTONIC ones
+		struct timespec now;
+		clock_gettime(CLOCK_MONOTONIC, &now);
+		backend->clock_ns = timespec_to_nsec(&now);
+	}
+	backend->clock_mode = mode;
+
+	if (!backend->started) {
+		return;
+	}
+
+	struct wlr_headless_output *output;
+	wl_list_for_each(output, &backend->outputs, link) {
+		if (output->present_pending) {
+			// Don't leave a committed buffer without a present event
+			struct timespec now;
+			clock_gettime(CLOCK_MONOTONIC, &now);
+			output->present_pending = false;
+			wlr_output_send_present(&output->wlr_output, NULL);
+			headless_output_capture_present(output, &now);
+		}
+		if (prev_mode == WLR_HEADLESS_CLOCK_UNTHROTTLED &&
+				mode != WLR_HEADLESS_CLOCK_UNTHROTTLED &&
+				output->idle_frame != NULL) {
+			// Frames are paced by the new clock from now on
+			wl_event_source_remove(output->idle_frame);
+			output->idle_frame = NULL;
+		}
+		headless_output_start_clock(output);
+	}
+}
+
+void wlr_headless_backend_advance_clock(struct wlr_backend *wlr_backend,
+		int64_t nsec) {
+	struct wlr_headless_backend *backend =
+		headless_backend_from_backend(wlr_backend);
+	if (backend->clock_mode != WLR_HEADLESS_CLOCK_MANUAL) {
+		wlr_log(WLR_ERROR, "Cannot advance the clock of a headless backend "
+			"which isn't in manual clock mode");
+		return;
+	}
+
+	backend->clock_ns += nsec;
+	if (!backend->started) {
+		return;
+	}
+
+	struct wlr_headless_output *output, *tmp;
+	wl_list_for_each_safe(output, tmp, &backend->outputs, link) {
+		while (output->next_vblank_ns <= backend->clock_ns) {
+			int64_t when_ns = output->next_vblank_ns;
+			output->next_vblank_ns += output_get_refresh_period_ns(output);
+			output_handle_virtual_vblank(output, when_ns);
+			wlr_output_send_frame(&output->wlr_output);
+		}
+	}
+}
+
 struct wlr_output *wlr_headless_add_output(struct wlr_backend *wlr_backend,
 		unsigned int width, unsigned int height) {
 	struct wlr_headless_backend *backend =
@@ -186,6 +350,7 @@ struct wlr_output *wlr_headless_add_output(struct wlr_backend *wlr_backend,
 		return NULL;
 	}
 	output->backend = backend;
+	output->capture_fd = -1;
 	wlr_output_init(&output->wlr_output, &backend->backend, &output_impl,
 		backend->display);
 	struct wlr_output *wlr_output = &output->wlr_output;
@@ -213,7 +378,7 @@ struct wlr_output *wlr_headless_add_output(struct wlr_backend *wlr_backend,
 	wl_list_insert(&backend->outputs, &output->link);
 
 	if (backend->started) {
-		wl_event_source_timer_update(output->frame_timer, output->frame_delay);
+		headless_output_start_clock(output);
 		wlr_output_update_enabled(wlr_output, true);
 		wlr_signal_emit_safe(&backend->backend.events.new_output, wlr_output);
 	}
@@ -19,8 +19,10 @@
 
 #include "backend/wayland.h"
 #include "render/drm_format_set.h"
-#include "render/gbm_allocator.h"
+#include "render/allocator.h"
+#include "render/pixel_format.h"
 #include "render/wlr_renderer.h"
+#include "types/wlr_buffer.h"
 #include "util/signal.h"
 
 #include "drm-client-protocol.h"
@@ -190,6 +192,18 @@ static const struct wl_drm_listener legacy_drm_listener = {
 	.capabilities = legacy_drm_handle_capabilities,
 };
 
+static void shm_handle_format(void *data, struct wl_shm *shm,
+		uint32_t shm_format) {
+	struct wlr_wl_backend *wl = data;
+	uint32_t drm_format = convert_wl_shm_format_to_drm(shm_format);
+	wlr_drm_format_set_add(&wl->shm_formats, drm_format,
+		DRM_FORMAT_MOD_INVALID);
+}
+
+static const struct wl_shm_listener shm_listener = {
+	.format = shm_handle_format,
+};
+
 static void registry_global(void *data, struct wl_registry *registry,
 		uint32_t name, const char *iface, uint32_t version) {
 	struct wlr_wl_backend *wl = data;
@@ -233,6 +247,9 @@ static void registry_global(void *data, struct wl_registry *registry,
 	} else if (strcmp(iface, wl_drm_interface.name) == 0) {
 		wl->legacy_drm = wl_registry_bind(registry, name, &wl_drm_interface, 1);
 		wl_drm_add_listener(wl->legacy_drm, &legacy_drm_listener, wl);
+	} else if (strcmp(iface, wl_shm_interface.name) == 0) {
+		wl->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+		wl_shm_add_listener(wl->shm, &shm_listener, wl);
 	}
 }
 
@@ -300,9 +317,12 @@ static void backend_destroy(struct wlr_backend *backend) {
 
 	wlr_renderer_destroy(wl->renderer);
 	wlr_allocator_destroy(wl->allocator);
-	close(wl->drm_fd);
+	if (wl->drm_fd >= 0) {
+		close(wl->drm_fd);
+	}
 
 	wlr_drm_format_set_finish(&wl->linux_dmabuf_v1_formats);
+	wlr_drm_format_set_finish(&wl->shm_formats);
 
 	struct wlr_wl_buffer *buffer, *tmp_buffer;
 	wl_list_for_each_safe(buffer, tmp_buffer, &wl->buffers, link) {
@@ -325,6 +345,9 @@ static void backend_destroy(struct wlr_backend *backend) {
 	if (wl->zwp_relative_pointer_manager_v1) {
 		zwp_relative_pointer_manager_v1_destroy(wl->zwp_relative_pointer_manager_v1);
 	}
+	if (wl->shm) {
+		wl_shm_destroy(wl->shm);
+	}
 	free(wl->drm_render_name);
 	xdg_wm_base_destroy(wl->xdg_wm_base);
 	wl_compositor_destroy(wl->compositor);
@@ -393,7 +416,7 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 
 	wl_registry_add_listener(wl->registry, &registry_listener, wl);
 	wl_display_roundtrip(wl->remote_display); // get globals
-	wl_display_roundtrip(wl->remote_display); // get linux-dmabuf formats
+	wl_display_roundtrip(wl->remote_display); // get formats
 
 	if (!wl->compositor) {
 		wlr_log(WLR_ERROR,
@@ -405,11 +428,6 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 			"Remote Wayland compositor does not support xdg-shell");
 		goto error_registry;
 	}
-	if (!wl->drm_render_name) {
-		wlr_log(WLR_ERROR, "Failed to get DRM render node from remote Wayland "
-			"compositor wl_drm interface");
-		goto error_registry;
-	}
 
 	struct wl_event_loop *loop = wl_display_get_event_loop(wl->local_display);
 	int fd = wl_display_get_fd(wl->remote_display);
@@ -421,61 +439,74 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 	}
 	wl_event_source_check(wl->remote_display_src);
 
-	wlr_log(WLR_DEBUG, "Opening DRM render node %s", wl->drm_render_name);
-	wl->drm_fd = open(wl->drm_render_name, O_RDWR | O_NONBLOCK | O_CLOEXEC);
-	if (wl->drm_fd < 0) {
-		wlr_log_errno(WLR_ERROR, "Failed to open DRM render node %s",
-			wl->drm_render_name);
-		goto error_remote_display_src;
-	}
-
-	int drm_fd = fcntl(wl->drm_fd, F_DUPFD_CLOEXEC, 0);
-	if (drm_fd < 0) {
-		wlr_log(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
-		goto error_drm_fd;
-	}
-
-	struct wlr_gbm_allocator *gbm_alloc = wlr_gbm_allocator_create(drm_fd);
-	if (gbm_alloc == NULL) {
-		wlr_log(WLR_ERROR, "Failed to create GBM allocator");
-		close(drm_fd);
-		goto error_drm_fd;
+	// Without a DRM render node, fall back to wl_shm buffers
+	wl->drm_fd = -1;
+	if (wl->drm_render_name != NULL && wl->zwp_linux_dmabuf_v1 != NULL) {
+		wlr_log(WLR_DEBUG, "Opening DRM render node %s", wl->drm_render_name);
+		wl->drm_fd = open(wl->drm_render_name, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+		if (wl->drm_fd < 0) {
+			wlr_log_errno(WLR_ERROR, "Failed to open DRM render node %s",
+				wl->drm_render_name);
+			goto error_remote_display_src;
+		}
+	} else {
+		wlr_log(WLR_INFO, "Remote Wayland compositor doesn't expose a DRM "
+			"render node, falling back to wl_shm");
 	}
-	wl->allocator = &gbm_alloc->base;
 
 	wl->renderer = wlr_renderer_autocreate(&wl->backend);
 	if (wl->renderer == NULL) {
 		wlr_log(WLR_ERROR, "Failed to create renderer");
-		goto error_allocator;
+		goto error_drm_fd;
 	}
 
-	uint32_t fmt = DRM_FORMAT_ARGB8888;
-	const struct wlr_drm_format *remote_format =
-		wlr_drm_format_set_get(&wl->linux_dmabuf_v1_formats, fmt);
-	if (remote_format == NULL) {
-		wlr_log(WLR_ERROR, "Remote compositor doesn't support format "
-			"0x%"PRIX32" via linux-dmabuf-unstable-v1", fmt);
+	wl->allocator = allocator_autocreate_with_drm_fd(wl->renderer, wl->drm_fd);
+	if (wl->allocator == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create allocator");
 		goto error_renderer;
 	}
 
+	uint32_t fmt = DRM_FORMAT_ARGB8888;
+	const struct wlr_drm_format *remote_format = NULL;
+	if (wl->allocator->buffer_caps & WLR_BUFFER_CAP_DMABUF) {
+		remote_format =
+			wlr_drm_format_set_get(&wl->linux_dmabuf_v1_formats, fmt);
+		if (remote_format == NULL) {
+			wlr_log(WLR_ERROR, "Remote compositor doesn't support format "
+				"0x%"PRIX32" via linux-dmabuf-unstable-v1", fmt);
+			goto error_allocator;
+		}
+	} else if (wl->allocator->buffer_caps & WLR_BUFFER_CAP_SHM) {
+		remote_format = wlr_drm_format_set_get(&wl->shm_formats, fmt);
+		if (remote_format == NULL) {
+			wlr_log(WLR_ERROR, "Remote compositor doesn't support format "
+				"0x%"PRIX32" via wl_shm", fmt);
+			goto error_allocator;
+		}
+	} else {
+		wlr_log(WLR_ERROR, "Allocator buffers can't be shared with the "
+			"remote compositor");
+		goto error_allocator;
+	}
+
 	const struct wlr_drm_format_set *render_formats =
-		wlr_renderer_get_dmabuf_render_formats(wl->renderer);
+		wlr_renderer_get_render_formats(wl->renderer);
 	if (render_formats == NULL) {
-		wlr_log(WLR_ERROR, "Failed to get available DMA-BUF formats from renderer");
-		goto error_renderer;
+		wlr_log(WLR_ERROR, "Failed to get available render formats from renderer");
+		goto error_allocator;
 	}
 	const struct wlr_drm_format *render_format =
 		wlr_drm_format_set_get(render_formats, fmt);
 	if (render_format == NULL) {
 		wlr_log(WLR_ERROR, "Renderer doesn't support DRM format 0x%"PRIX32, fmt);
-		goto error_renderer;
+		goto error_allocator;
 	}
 
 	wl->format = wlr_drm_format_intersect(remote_format, render_format);
 	if (wl->format == NULL) {
 		wlr_log(WLR_ERROR, "Failed to intersect remote and render modifiers "
 			"for format 0x%"PRIX32, fmt);
-		goto error_renderer;
+		goto error_allocator;
 	}
 
 	wl->local_display_destroy.notify = handle_display_destroy;
@@ -483,15 +514,21 @@ struct wlr_backend *wlr_wl_backend_create(struct wl_display *display,
 
 	return &wl->backend;
 
-error_renderer:
-	wlr_renderer_destroy(wl->renderer);
 error_allocator:
 	wlr_allocator_destroy(wl->allocator);
+error_renderer:
+	wlr_renderer_destroy(wl->renderer);
 error_drm_fd:
-	close(wl->drm_fd);
+	if (wl->drm_fd >= 0) {
+		close(wl->drm_fd);
+	}
 error_remote_display_src:
 	wl_event_source_remove(wl->remote_display_src);
 error_registry:
+	wlr_drm_format_set_finish(&wl->shm_formats);
+	if (wl->shm) {
+		wl_shm_destroy(wl->shm);
+	}
 	free(wl->drm_render_name);
 	if (wl->compositor) {
 		wl_compositor_destroy(wl->compositor);
@@ -17,6 +17,7 @@
 #include <xcb/dri3.h>
 #include <xcb/present.h>
 #include <xcb/render.h>
+#include <xcb/shm.h>
 #include <xcb/xcb_renderutil.h>
 #include <xcb/xfixes.h>
 #include <xcb/xinput.h>
@@ -31,8 +32,9 @@
 
 #include "backend/x11.h"
 #include "render/drm_format_set.h"
-#include "render/gbm_allocator.h"
+#include "render/allocator.h"
 #include "render/wlr_renderer.h"
+#include "types/wlr_buffer.h"
 #include "util/signal.h"
 
 // See dri2_format_for_depth in mesa
@@ -189,13 +191,16 @@ static void backend_destroy(struct wlr_backend *backend) {
 	wlr_renderer_destroy(x11->renderer);
 	wlr_allocator_destroy(x11->allocator);
 	wlr_drm_format_set_finish(&x11->dri3_formats);
+	wlr_drm_format_set_finish(&x11->shm_formats);
 	free(x11->drm_format);
 
 #if HAS_XCB_ERRORS
 	xcb_errors_context_free(x11->errors_context);
 #endif
 
-	close(x11->drm_fd);
+	if (x11->drm_fd >= 0) {
+		close(x11->drm_fd);
+	}
 	xcb_disconnect(x11->xcb);
 	free(x11);
 }
@@ -429,24 +434,57 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 	// DRI3 extension
 
 	ext = xcb_get_extension_data(x11->xcb, &xcb_dri3_id);
-	if (!ext || !ext->present) {
-		wlr_log(WLR_ERROR, "X11 does not support DRI3 extension");
-		goto error_display;
+	if (ext && ext->present) {
+		xcb_dri3_query_version_cookie_t dri3_cookie =
+			xcb_dri3_query_version(x11->xcb, 1, 2);
+		xcb_dri3_query_version_reply_t *dri3_reply =
+			xcb_dri3_query_version_reply(x11->xcb, dri3_cookie, NULL);
+		if (dri3_reply && dri3_reply->major_version >= 1) {
+			x11->have_dri3 = true;
+			x11->dri3_major_version = dri3_reply->major_version;
+			x11->dri3_minor_version = dri3_reply->minor_version;
+		} else {
+			wlr_log(WLR_INFO, "X11 does not support required DRI3 version "
+				"(has %"PRIu32".%"PRIu32", want 1.0)",
+				dri3_reply ? dri3_reply->major_version : 0,
+				dri3_reply ? dri3_reply->minor_version : 0);
+		}
+		free(dri3_reply);
+	} else {
+		wlr_log(WLR_INFO, "X11 does not support DRI3 extension");
+	}
+
+	// SHM extension
+
+	ext = xcb_get_extension_data(x11->xcb, &xcb_shm_id);
+	if (ext && ext->present) {
+		xcb_shm_query_version_cookie_t shm_cookie =
+			xcb_shm_query_version(x11->xcb);
+		xcb_shm_query_version_reply_t *shm_reply =
+			xcb_shm_query_version_reply(x11->xcb, shm_cookie, NULL);
+		if (shm_reply) {
+			// AttachFd requires SHM 1.2
+			if (shm_reply->major_version >= 2 ||
+					(shm_reply->major_version == 1 &&
+					shm_reply->minor_version >= 2)) {
+				x11->have_shm = true;
+			} else {
+				wlr_log(WLR_INFO, "X11 does not support required SHM version "
+					"(has %"PRIu32".%"PRIu32", want 1.2)",
+					shm_reply->major_version, shm_reply->minor_version);
+			}
+		} else {
+			wlr_log(WLR_INFO, "X11 does not support required SHM version");
+		}
+		free(shm_reply);
+	} else {
+		wlr_log(WLR_INFO, "X11 does not support SHM extension");
 	}
 
-	xcb_dri3_query_version_cookie_t dri3_cookie =
-		xcb_dri3_query_version(x11->xcb, 1, 2);
-	xcb_dri3_query_version_reply_t *dri3_reply =
-		xcb_dri3_query_version_reply(x11->xcb, dri3_cookie, NULL);
-	if (!dri3_reply || dri3_reply->major_version < 1) {
-		wlr_log(WLR_ERROR, "X11 does not support required DRI3 version "
-			"(has %"PRIu32".%"PRIu32", want 1.0)",
-			dri3_reply->major_version, dri3_reply->minor_version);
+	if (!x11->have_dri3 && !x11->have_shm) {
+		wlr_log(WLR_ERROR, "X11 supports neither DRI3 nor SHM");
 		goto error_display;
 	}
-	x11->dri3_major_version = dri3_reply->major_version;
-	x11->dri3_minor_version = dri3_reply->minor_version;
-	free(dri3_reply);
 
 	// Present extension
 
@@ -552,30 +590,22 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 		x11->screen->root, x11->visualid);
 
 	// DRI3 may return a render node (Xwayland) or an authenticated primary
-	// node (plain Glamor).
-	x11->drm_fd = query_dri3_drm_fd(x11);
-	if (x11->drm_fd < 0) {
-		wlr_log(WLR_ERROR, "Failed to query DRI3 DRM FD");
-		goto error_event;
-	}
-
-	char *drm_name = drmGetDeviceNameFromFd2(x11->drm_fd);
-	wlr_log(WLR_DEBUG, "Using DRM node %s", drm_name);
-	free(drm_name);
-
-	int drm_fd = fcntl(x11->drm_fd, F_DUPFD_CLOEXEC, 0);
-	if (drm_fd < 0) {
-		wlr_log(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
-		goto error_event;
-	}
-
-	struct wlr_gbm_allocator *gbm_alloc = wlr_gbm_allocator_create(drm_fd);
-	if (gbm_alloc == NULL) {
-		wlr_log(WLR_ERROR, "Failed to create GBM allocator");
-		close(drm_fd);
-		goto error_event;
+	// node (plain Glamor). Without it, fall back to MIT-SHM.
+	x11->drm_fd = -1;
+	if (x11->have_dri3) {
+		x11->drm_fd = query_dri3_drm_fd(x11);
+		if (x11->drm_fd >= 0) {
+			char *drm_name = drmGetDeviceNameFromFd2(x11->drm_fd);
+			wlr_log(WLR_DEBUG, "Using DRM node %s", drm_name);
+			free(drm_name);
+		} else if (x11->have_shm) {
+			wlr_log(WLR_INFO, "Failed to query DRI3 DRM FD, "
+				"falling back to SHM");
+		} else {
+			wlr_log(WLR_ERROR, "Failed to query DRI3 DRM FD");
+			goto error_event;
+		}
 	}
-	x11->allocator = &gbm_alloc->base;
 
 	x11->renderer = wlr_renderer_autocreate(&x11->backend);
 	if (x11->renderer == NULL) {
@@ -583,10 +613,17 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 		goto error_event;
 	}
 
+	x11->allocator = allocator_autocreate_with_drm_fd(x11->renderer,
+		x11->drm_fd);
+	if (x11->allocator == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create allocator");
+		goto error_event;
+	}
+
 	const struct wlr_drm_format_set *render_formats =
-		wlr_renderer_get_dmabuf_render_formats(x11->renderer);
+		wlr_renderer_get_render_formats(x11->renderer);
 	if (render_formats == NULL) {
-		wlr_log(WLR_ERROR, "Failed to get available DMA-BUF formats from renderer");
+		wlr_log(WLR_ERROR, "Failed to get available render formats from renderer");
 		return false;
 	}
 	const struct wlr_drm_format *render_format =
@@ -597,22 +634,36 @@ struct wlr_backend *wlr_x11_backend_create(struct wl_display *display,
 		return false;
 	}
 
-	if (!query_dri3_formats(x11)) {
-		wlr_log(WLR_ERROR, "Failed to query supported DRI3 formats");
+	const struct wlr_drm_format *x11_format = NULL;
+	if ((x11->allocator->buffer_caps & WLR_BUFFER_CAP_DMABUF) &&
+			x11->have_dri3) {
+		if (!query_dri3_formats(x11)) {
+			wlr_log(WLR_ERROR, "Failed to query supported DRI3 formats");
+			return false;
+		}
+		x11_format = wlr_drm_format_set_get(&x11->dri3_formats,
+			x11->x11_format->drm);
+	} else if ((x11->allocator->buffer_caps & WLR_BUFFER_CAP_SHM) &&
+			x11->have_shm) {
+		// Pixmaps created from SHM segments always use a linear layout
+		wlr_drm_format_set_add(&x11->shm_formats, x11->x11_format->drm,
+			DRM_FORMAT_MOD_INVALID);
+		x11_format = wlr_drm_format_set_get(&x11->shm_formats,
+			x11->x11_format->drm);
+	} else {
+		wlr_log(WLR_ERROR, "Allocator buffers can't be shared with the "
+			"X11 server");
 		return false;
 	}
-
-	const struct wlr_drm_format *dri3_format =
-		wlr_drm_format_set_get(&x11->dri3_formats, x11->x11_format->drm);
-	if (dri3_format == NULL) {
+	if (x11_format == NULL) {
 		wlr_log(WLR_ERROR, "X11 server doesn't support DRM format 0x%"PRIX32,
 			x11->x11_format->drm);
 		return false;
 	}
 
-	x11->drm_format = wlr_drm_format_intersect(dri3_format, render_format);
+	x11->drm_format = wlr_drm_format_intersect(x11_format, render_format);
 	if (x11->drm_format == NULL) {
-		wlr_log(WLR_ERROR, "Failed to intersect DRI3 and render modifiers for "
+		wlr_log(WLR_ERROR, "Failed to intersect X11 and render modifiers for "
 			"format 0x%"PRIX32, x11->x11_format->drm);
 		return false;
 	}
@@ -0,0 +1,628 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wayland-client.h>
+#include "bench.h"
+#include "xdg-shell-client-protocol.h"
+
+#define BUFFERS_PER_SURFACE 2
+#define POPUP_SIZE 64
+
+struct bench_buffer {
+	struct wl_buffer *wl_buffer;
+	uint32_t *data;
+	size_t size;
+	bool busy;
+};
+
+struct bench_surface {
+	struct wl_surface *wl_surface;
+	struct wl_subsurface *wl_subsurface; // NULL for the toplevel
+	int width, height;
+	struct bench_buffer buffers[BUFFERS_PER_SURFACE];
+};
+
+struct bench_client {
+	struct bench_clients *clients;
+	struct wl_display *display;
+
+	struct wl_compositor *compositor;
+	struct wl_subcompositor *subcompositor;
+	struct wl_shm *shm;
+	struct xdg_wm_base *wm_base;
+	struct wl_seat *seat;
+	struct wl_pointer *pointer;
+
+	struct bench_surface toplevel;
+	struct xdg_surface *xdg_surface;
+	struct xdg_toplevel *xdg_toplevel;
+	struct bench_surface *subsurfaces;
+	bool configured;
+
+	struct bench_buffer popup_buffer;
+	struct wl_surface *popup_surface;
+	struct xdg_surface *popup_xdg_surface;
+	struct xdg_popup *popup;
+
+	uint32_t color;
+	uint64_t frame_count;
+	struct bench_client_stats stats;
+};
+
+struct bench_clients {
+	struct bench_client_options options;
+	struct bench_client *clients;
+	size_t clients_len;
+
+	int *fds; // connected sockets, owned by the clients once started
+	pthread_t thread;
+	int stop_fds[2];
+};
+
+static void buffer_handle_release(void *data, struct wl_buffer *wl_buffer) {
+	struct bench_buffer *buffer = data;
+	buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	.release = buffer_handle_release,
+};
+
+static bool buffer_init(struct bench_buffer *buffer, struct wl_shm *shm,
+		int width, int height) {
+	static int counter = 0;
+	char name[64];
+	snprintf(name, sizeof(name), "/wlroots-bench-%d-%d", getpid(), counter++);
+
+	int stride = width * 4;
+	buffer->size = (size_t)stride * height;
+
+	int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+	if (fd < 0) {
+		fprintf(stderr, "shm_open failed\n");
+		return false;
+	}
+	shm_unlink(name);
+
+	int ret;
+	while ((ret = ftruncate(fd, buffer->size)) < 0 && errno == EINTR) {
+		// No-op
+	}
+	if (ret < 0) {
+		close(fd);
+		fprintf(stderr, "ftruncate failed\n");
+		return false;
+	}
+
+	buffer->data = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE,
+		MAP_SHARED, fd, 0);
+	if (buffer->data == MAP_FAILED) {
+		perror("mmap failed");
+		close(fd);
+		return false;
+	}
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, buffer->size);
+	close(fd);
+	buffer->wl_buffer = wl_shm_pool_create_buffer(pool, 0, width, height,
+		stride, WL_SHM_FORMAT_XRGB8888);
+	wl_shm_pool_destroy(pool);
+	wl_buffer_add_listener(buffer->wl_buffer, &buffer_listener, buffer);
+	return true;
+}
+
+static void buffer_finish(struct bench_buffer *buffer) {
+	if (buffer->wl_buffer == NULL) {
+		return;
+	}
+	wl_buffer_destroy(buffer->wl_buffer);
+	munmap(buffer->data, buffer->size);
+}
+
+static void fill_buffer(struct bench_buffer *buffer, uint32_t color) {
+	size_t len = buffer->size / sizeof(uint32_t);
+	for (size_t i = 0; i < len; i++) {
+		buffer->data[i] = color;
+	}
+}
+
+static bool surface_init(struct bench_surface *surface,
+		struct bench_client *client, int width, int height) {
+	surface->wl_surface = wl_compositor_create_surface(client->compositor);
+	surface->width = width;
+	surface->height = height;
+	for (size_t i = 0; i < BUFFERS_PER_SURFACE; i++) {
+		if (!buffer_init(&surface->buffers[i], client->shm, width, height)) {
+			return false;
+		}
+	}
+	return true;
+}
+
+static void surface_finish(struct bench_surface *surface) {
+	for (size_t i = 0; i < BUFFERS_PER_SURFACE; i++) {
+		buffer_finish(&surface->buffers[i]);
+	}
+	if (surface->wl_subsurface != NULL) {
+		wl_subsurface_destroy(surface->wl_subsurface);
+	}
+	if (surface->wl_surface != NULL) {
+		wl_surface_destroy(surface->wl_surface);
+	}
+}
+
+/**
+ * Redraw the whole surface into a free buffer, and commit it.
+ */
+static void surface_draw(struct bench_surface *surface,
+		struct bench_client *client) {
+	struct bench_buffer *buffer = NULL;
+	for (size_t i = 0; i < BUFFERS_PER_SURFACE; i++) {
+		if (!surface->buffers[i].busy) {
+			buffer = &surface->buffers[i];
+			break;
+		}
+	}
+
+	if (buffer != NULL) {
+		fill_buffer(buffer, client->color);
+		buffer->busy = true;
+		wl_surface_attach(surface->wl_surface, buffer->wl_buffer, 0, 0);
+		wl_surface_damage_buffer(surface->wl_surface, 0, 0,
+			surface->width, surface->height);
+	}
+	wl_surface_commit(surface->wl_surface);
+	client->stats.commits++;
+}
+
+static void popup_destroy(struct bench_client *client) {
+	if (client->popup == NULL) {
+		return;
+	}
+	xdg_popup_destroy(client->popup);
+	xdg_surface_destroy(client->popup_xdg_surface);
+	wl_surface_destroy(client->popup_surface);
+	client->popup = NULL;
+	client->popup_xdg_surface = NULL;
+	client->popup_surface = NULL;
+}
+
+static void popup_xdg_surface_handle_configure(void *data,
+		struct xdg_surface *xdg_surface, uint32_t serial) {
+	struct bench_client *client = data;
+	xdg_surface_ack_configure(xdg_surface, serial);
+	fill_buffer(&client->popup_buffer, ~client->color);
+	wl_surface_attach(client->popup_surface,
+		client->popup_buffer.wl_buffer, 0, 0);
+	wl_surface_damage_buffer(client->popup_surface, 0, 0,
+		POPUP_SIZE, POPUP_SIZE);
+	wl_surface_commit(client->popup_surface);
+	client->stats.commits++;
+	client->stats.popups++;
+}
+
+static const struct xdg_surface_listener popup_xdg_surface_listener = {
+	.configure = popup_xdg_surface_handle_configure,
+};
+
+static void popup_handle_configure(void *data, struct xdg_popup *popup,
+		int32_t x, int32_t y, int32_t width, int32_t height) {
+	// No-op
+}
+
+static void popup_handle_popup_done(void *data, struct xdg_popup *popup) {
+	struct bench_client *client = data;
+	popup_destroy(client);
+}
+
+static const struct xdg_popup_listener popup_listener = {
+	.configure = popup_handle_configure,
+	.popup_done = popup_handle_popup_done,
+};
+
+static void popup_create(struct bench_client *client) {
+	// Move the popup around the toplevel
+	int x_range = client->toplevel.width - POPUP_SIZE;
+	int y_range = client->toplevel.height - POPUP_SIZE;
+
+	struct xdg_positioner *positioner =
+		xdg_wm_base_create_positioner(client->wm_base);
+	xdg_positioner_set_size(positioner, POPUP_SIZE, POPUP_SIZE);
+	xdg_positioner_set_anchor_rect(positioner,
+		x_range > 0 ? client->frame_count % x_range : 0,
+		y_range > 0 ? client->frame_count % y_range : 0, 1, 1);
+
+	client->popup_surface = wl_compositor_create_surface(client->compositor);
+	client->popup_xdg_surface = xdg_wm_base_get_xdg_surface(client->wm_base,
+		client->popup_surface);
+	xdg_surface_add_listener(client->popup_xdg_surface,
+		&popup_xdg_surface_listener, client);
+	client->popup = xdg_surface_get_popup(client->popup_xdg_surface,
+		client->xdg_surface, positioner);
+	xdg_popup_add_listener(client->popup, &popup_listener, client);
+	xdg_positioner_destroy(positioner);
+
+	wl_surface_commit(client->popup_surface);
+	client->stats.commits++;
+}
+
+static void client_draw(struct bench_client *client);
+
+static void frame_handle_done(void *data, struct wl_callback *callback,
+		uint32_t time) {
+	struct bench_client *client = data;
+	wl_callback_destroy(callback);
+	client->stats.frames++;
+	client_draw(client);
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = frame_handle_done,
+};
+
+static void client_draw(struct bench_client *client) {
+	const struct bench_client_options *options = &client->clients->options;
+
+	client->frame_count++;
+	client->color = 0xFF000000 | (client->frame_count * 0x010203);
+
+	if (options->popup_interval > 0 &&
+			client->frame_count % options->popup_interval == 0) {
+		popup_destroy(client);
+		popup_create(client);
+	}
+
+	// Sub-surfaces are synchronized: their state is applied along with the
+	// next toplevel commit
+	for (int i = 0; i < options->subsurfaces; i++) {
+		surface_draw(&client->subsurfaces[i], client);
+	}
+
+	struct wl_callback *callback =
+		wl_surface_frame(client->toplevel.wl_surface);
+	wl_callback_add_listener(callback, &frame_listener, client);
+	surface_draw(&client->toplevel, client);
+}
+
+static void xdg_surface_handle_configure(void *data,
+		struct xdg_surface *xdg_surface, uint32_t serial) {
+	struct bench_client *client = data;
+	xdg_surface_ack_configure(xdg_surface, serial);
+	if (!client->configured) {
+		client->configured = true;
+		client_draw(client);
+	}
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = xdg_surface_handle_configure,
+};
+
+static void xdg_toplevel_handle_configure(void *data,
+		struct xdg_toplevel *xdg_toplevel, int32_t width, int32_t height,
+		struct wl_array *states) {
+	// The surfaces keep their size, the compositor doesn't impose one
+}
+
+static void xdg_toplevel_handle_close(void *data,
+		struct xdg_toplevel *xdg_toplevel) {
+	// No-op
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+	.configure = xdg_toplevel_handle_configure,
+	.close = xdg_toplevel_handle_close,
+};
+
+static void wm_base_handle_ping(void *data, struct xdg_wm_base *wm_base,
+		uint32_t serial) {
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = wm_base_handle_ping,
+};
+
+static void pointer_handle_enter(void *data, struct wl_pointer *pointer,
+		uint32_t serial, struct wl_surface *surface,
+		wl_fixed_t sx, wl_fixed_t sy) {
+	// No-op
+}
+
+static void pointer_handle_leave(void *data, struct wl_pointer *pointer,
+		uint32_t serial, struct wl_surface *surface) {
+	// No-op
+}
+
+static void pointer_handle_motion(void *data, struct wl_pointer *pointer,
+		uint32_t time, wl_fixed_t sx, wl_fixed_t sy) {
+	struct bench_client *client = data;
+	client->stats.pointer_motions++;
+}
+
+static void pointer_handle_button(void *data, struct wl_pointer *pointer,
+		uint32_t serial, uint32_t time, uint32_t button, uint32_t state) {
+	// No-op
+}
+
+static void pointer_handle_axis(void *data, struct wl_pointer *pointer,
+		uint32_t time, uint32_t axis, wl_fixed_t value) {
+	// No-op
+}
+
+static const struct wl_pointer_listener pointer_listener = {
+	.enter = pointer_handle_enter,
+	.leave = pointer_handle_leave,
+	.motion = pointer_handle_motion,
+	.button = pointer_handle_button,
+	.axis = pointer_handle_axis,
+};
+
+static void seat_handle_capabilities(void *data, struct wl_seat *seat,
+		uint32_t caps) {
+	struct bench_client *client = data;
+	if ((caps & WL_SEAT_CAPABILITY_POINTER) && client->pointer == NULL) {
+		client->pointer = wl_seat_get_pointer(seat);
+		wl_pointer_add_listener(client->pointer, &pointer_listener, client);
+	}
+}
+
+static void seat_handle_name(void *data, struct wl_seat *seat,
+		const char *name) {
+	// No-op
+}
+
+static const struct wl_seat_listener seat_listener = {
+	.capabilities = seat_handle_capabilities,
+	.name = seat_handle_name,
+};
+
+static void registry_handle_global(void *data, struct wl_registry *registry,
+		uint32_t name, const char *interface, uint32_t version) {
+	struct bench_client *client = data;
+	if (strcmp(interface, wl_compositor_interface.name) == 0) {
+		client->compositor = wl_registry_bind(registry, name,
+			&wl_compositor_interface, 4);
+	} else if (strcmp(interface, wl_subcompositor_interface.name) == 0) {
+		client->subcompositor = wl_registry_bind(registry, name,
+			&wl_subcompositor_interface, 1);
+	} else if (strcmp(interface, wl_shm_interface.name) == 0) {
+		client->shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+		client->wm_base = wl_registry_bind(registry, name,
+			&xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(client->wm_base, &wm_base_listener, client);
+	} else if (strcmp(interface, wl_seat_interface.name) == 0 &&
+			client->seat == NULL) {
+		client->seat = wl_registry_bind(registry, name, &wl_seat_interface, 1);
+		wl_seat_add_listener(client->seat, &seat_listener, client);
+	}
+}
+
+static void registry_handle_global_remove(void *data,
+		struct wl_registry *registry, uint32_t name) {
+	// No-op
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = registry_handle_global,
+	.global_remove = registry_handle_global_remove,
+};
+
+static bool client_init(struct bench_client *client, int fd) {
+	const struct bench_client_options *options = &client->clients->options;
+
+	client->display = wl_display_connect_to_fd(fd);
+	if (client->display == NULL) {
+		fprintf(stderr, "Failed to connect client\n");
+		close(fd);
+		return false;
+	}
+
+	struct wl_registry *registry = wl_display_get_registry(client->display);
+	wl_registry_add_listener(registry, &registry_listener, client);
+	wl_display_roundtrip(client->display);
+	wl_registry_destroy(registry);
+
+	if (client->compositor == NULL || client->subcompositor == NULL ||
+			client->shm == NULL || client->wm_base == NULL) {
+		fprintf(stderr, "Missing required globals\n");
+		return false;
+	}
+
+	if (!surface_init(&client->toplevel, client,
+			options->width, options->height)) {
+		return false;
+	}
+	if (!buffer_init(&client->popup_buffer, client->shm,
+			POPUP_SIZE, POPUP_SIZE)) {
+		return false;
+	}
+
+	client->subsurfaces =
+		calloc(options->subsurfaces, sizeof(struct bench_surface));
+	if (options->subsurfaces > 0 && client->subsurfaces == NULL) {
+		return false;
+	}
+	for (int i = 0; i < options->subsurfaces; i++) {
+		// Nest each sub-surface in the previous one, diagonally
+		struct bench_surface *parent =
+			i > 0 ? &client->subsurfaces[i - 1] : &client->toplevel;
+		struct bench_surface *surface = &client->subsurfaces[i];
+		if (!surface_init(surface, client,
+				parent->width / 2, parent->height / 2)) {
+			return false;
+		}
+		surface->wl_subsurface = wl_subcompositor_get_subsurface(
+			client->subcompositor, surface->wl_surface, parent->wl_surface);
+		wl_subsurface_set_position(surface->wl_subsurface,
+			parent->width / 4, parent->height / 4);
+	}
+
+	client->xdg_surface = xdg_wm_base_get_xdg_surface(client->wm_base,
+		client->toplevel.wl_surface);
+	xdg_surface_add_listener(client->xdg_surface, &xdg_surface_listener,
+		client);
+	client->xdg_toplevel = xdg_surface_get_toplevel(client->xdg_surface);
+	xdg_toplevel_add_listener(client->xdg_toplevel, &xdg_toplevel_listener,
+		client);
+	xdg_toplevel_set_title(client->xdg_toplevel, "bench");
+	wl_surface_commit(client->toplevel.wl_surface);
+	client->stats.commits++;
+
+	return wl_display_flush(client->display) >= 0;
+}
+
+static void client_finish(struct bench_client *client) {
+	if (client->display == NULL) {
+		return;
+	}
+
+	popup_destroy(client);
+	if (client->xdg_toplevel != NULL) {
+		xdg_toplevel_destroy(client->xdg_toplevel);
+	}
+	if (client->xdg_surface != NULL) {
+		xdg_surface_destroy(client->xdg_surface);
+	}
+	if (client->subsurfaces != NULL) {
+		for (int i = client->clients->options.subsurfaces - 1; i >= 0; i--) {
+			surface_finish(&client->subsurfaces[i]);
+		}
+		free(client->subsurfaces);
+	}
+	surface_finish(&client->toplevel);
+	buffer_finish(&client->popup_buffer);
+	wl_display_disconnect(client->display);
+}
+
+static void *clients_run(void *data) {
+	struct bench_clients *clients = data;
+
+	// Connecting requires round-trips, so it can't happen on the compositor
+	// thread
+	for (size_t i = 0; i < clients->clients_len; i++) {
+		if (!client_init(&clients->clients[i], clients->fds[i])) {
+			fprintf(stderr, "Failed to initialize client\n");
+			return NULL;
+		}
+	}
+
+	size_t fds_len = clients->clients_len + 1;
+	struct pollfd *fds = calloc(fds_len, sizeof(struct pollfd));
+	if (fds == NULL) {
+		return NULL;
+	}
+	for (size_t i = 0; i < clients->clients_len; i++) {
+		fds[i].fd = wl_display_get_fd(clients->clients[i].display);
+		fds[i].events = POLLIN;
+	}
+	fds[clients->clients_len].fd = clients->stop_fds[0];
+	fds[clients->clients_len].events = POLLIN;
+
+	while (true) {
+		for (size_t i = 0; i < clients->clients_len; i++) {
+			wl_display_flush(clients->clients[i].display);
+		}
+
+		if (poll(fds, fds_len, -1) < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll failed");
+			break;
+		}
+
+		if (fds[clients->clients_len].revents != 0) {
+			break;
+		}
+
+		bool error = false;
+		for (size_t i = 0; i < clients->clients_len; i++) {
+			if (fds[i].revents == 0) {
+				continue;
+			}
+			if (wl_display_dispatch(clients->clients[i].display) < 0) {
+				error = true;
+			}
+		}
+		if (error) {
+			fprintf(stderr, "Client disconnected\n");
+			break;
+		}
+	}
+
+	free(fds);
+	return NULL;
+}
+
+struct bench_clients *bench_clients_start(const int *fds, size_t fds_len,
+		const struct bench_client_options *options) {
+	struct bench_clients *clients = calloc(1, sizeof(struct bench_clients));
+	if (clients == NULL) {
+		return NULL;
+	}
+	clients->options = *options;
+	clients->clients_len = fds_len;
+	clients->clients = calloc(fds_len, sizeof(struct bench_client));
+	clients->fds = calloc(fds_len, sizeof(int));
+	if (clients->clients == NULL || clients->fds == NULL) {
+		goto error;
+	}
+	memcpy(clients->fds, fds, fds_len * sizeof(int));
+
+	for (size_t i = 0; i < fds_len; i++) {
+		clients->clients[i].clients = clients;
+	}
+
+	if (pipe(clients->stop_fds) != 0) {
+		goto error;
+	}
+	if (pthread_create(&clients->thread, NULL, clients_run, clients) != 0) {
+		close(clients->stop_fds[0]);
+		close(clients->stop_fds[1]);
+		goto error;
+	}
+
+	return clients;
+
+error:
+	free(clients->fds);
+	free(clients->clients);
+	free(clients);
+	return NULL;
+}
+
+void bench_clients_stop(struct bench_clients *clients,
+		struct bench_client_stats *stats) {
+	char c = 0;
+	if (write(clients->stop_fds[1], &c, 1) != 1) {
+		perror("write failed");
+	}
+	pthread_join(clients->thread, NULL);
+
+	memset(stats, 0, sizeof(*stats));
+	for (size_t i = 0; i < clients->clients_len; i++) {
+		struct bench_client *client = &clients->clients[i];
+		stats->commits += client->stats.commits;
+		stats->frames += client->stats.frames;
+		stats->pointer_motions += client->stats.pointer_motions;
+		stats->popups += client->stats.popups;
+		client_finish(client);
+	}
+
+	close(clients->stop_fds[0]);
+	close(clients->stop_fds[1]);
+	free(clients->fds);
+	free(clients->clients);
+	free(clients);
+}
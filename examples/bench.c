@@ -0,0 +1,348 @@
+#define _POSIX_C_SOURCE 200809L
+#include <getopt.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-server-core.h>
+#include <wlr/backend.h>
+#include <wlr/backend/headless.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_compositor.h>
+#include <wlr/types/wlr_cursor.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_output_layout.h>
+#include <wlr/types/wlr_output_timing.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_seat.h>
+#include <wlr/types/wlr_xdg_shell.h>
+#include <wlr/util/log.h>
+#include "bench.h"
+
+/**
+ * A benchmark driving wlroots with synthetic clients.
+ *
+ * A headless backend with an unthrottled virtual clock renders frames as fast
+ * as possible with the scene-graph API. In-process clients connected through
+ * socket pairs map toplevels with nested sub-surfaces, redraw them from shared
+ * memory buffers on every frame and periodically re-create popups, while the
+ * pointer is moved several times per frame. Frame throughput, frame time
+ * percentiles and the peak memory usage are printed at the end of the run.
+ */
+
+struct bench_state {
+	struct wl_display *display;
+	struct wlr_backend *backend;
+	struct wlr_renderer *renderer;
+	struct wlr_output_layout *layout;
+	struct wlr_scene *scene;
+	struct wlr_seat *seat;
+	struct wlr_cursor *cursor;
+
+	struct wlr_xdg_shell *xdg_shell;
+	struct wl_listener new_output;
+	struct wl_listener new_xdg_surface;
+
+	int frames_target;
+	int pointer_motions_per_frame;
+	int views;
+
+	struct wlr_output_timing *output_timing;
+	int frames;
+	struct timespec start, last_frame;
+	int64_t *frame_times_ns;
+};
+
+struct bench_output {
+	struct bench_state *state;
+	struct wlr_scene_output *scene_output;
+	struct wl_listener frame;
+	struct wl_listener destroy;
+};
+
+static int64_t timespec_diff_ns(const struct timespec *a,
+		const struct timespec *b) {
+	return (int64_t)(a->tv_sec - b->tv_sec) * 1000000000 +
+		(a->tv_nsec - b->tv_nsec);
+}
+
+static void process_pointer_motion(struct bench_state *state) {
+	// Sweep the whole layout back and forth, to cross surfaces
+	for (int i = 0; i < state->pointer_motions_per_frame; i++) {
+		double dx = (state->frames / 64) % 2 == 0 ? 7 : -7;
+		wlr_cursor_move(state->cursor, NULL, dx, 3);
+		if (state->cursor->y >= 700) {
+			wlr_cursor_warp(state->cursor, NULL, state->cursor->x, 0);
+		}
+
+		double sx, sy;
+		struct wlr_scene_node *node = wlr_scene_node_at(&state->scene->node,
+			state->cursor->x, state->cursor->y, &sx, &sy);
+		if (node == NULL || node->type != WLR_SCENE_NODE_SURFACE) {
+			wlr_seat_pointer_clear_focus(state->seat);
+			continue;
+		}
+		struct wlr_surface *surface = wlr_scene_surface_from_node(node)->surface;
+		uint32_t time = state->last_frame.tv_sec * 1000 +
+			state->last_frame.tv_nsec / 1000000;
+		wlr_seat_pointer_notify_enter(state->seat, surface, sx, sy);
+		wlr_seat_pointer_notify_motion(state->seat, time, sx, sy);
+		wlr_seat_pointer_notify_frame(state->seat);
+	}
+}
+
+static void output_handle_frame(struct wl_listener *listener, void *data) {
+	struct bench_output *output = wl_container_of(listener, output, frame);
+	struct bench_state *state = output->state;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	if (state->frames == 0) {
+		state->start = now;
+	} else {
+		state->frame_times_ns[state->frames - 1] =
+			timespec_diff_ns(&now, &state->last_frame);
+	}
+	state->last_frame = now;
+
+	if (state->frames == state->frames_target) {
+		wl_display_terminate(state->display);
+		return;
+	}
+	state->frames++;
+
+	process_pointer_motion(state);
+
+	wlr_scene_output_commit(output->scene_output);
+	wlr_scene_output_send_frame_done(output->scene_output, &now);
+}
+
+static void output_handle_destroy(struct wl_listener *listener, void *data) {
+	struct bench_output *output = wl_container_of(listener, output, destroy);
+	wl_list_remove(&output->frame.link);
+	wl_list_remove(&output->destroy.link);
+	free(output);
+}
+
+static void handle_new_output(struct wl_listener *listener, void *data) {
+	struct bench_state *state = wl_container_of(listener, state, new_output);
+	struct wlr_output *wlr_output = data;
+
+	struct bench_output *output = calloc(1, sizeof(struct bench_output));
+	if (output == NULL) {
+		exit(EXIT_FAILURE);
+	}
+	output->state = state;
+
+	wlr_output_layout_add_auto(state->layout, wlr_output);
+	output->scene_output = wlr_scene_output_create(state->scene, wlr_output);
+	state->output_timing = wlr_output_timing_create(wlr_output);
+
+	output->frame.notify = output_handle_frame;
+	wl_signal_add(&wlr_output->events.frame, &output->frame);
+	output->destroy.notify = output_handle_destroy;
+	wl_signal_add(&wlr_output->events.destroy, &output->destroy);
+}
+
+static void handle_new_xdg_surface(struct wl_listener *listener, void *data) {
+	struct bench_state *state =
+		wl_container_of(listener, state, new_xdg_surface);
+	struct wlr_xdg_surface *xdg_surface = data;
+
+	// Popups are added to the scene along with their parent
+	if (xdg_surface->role != WLR_XDG_SURFACE_ROLE_TOPLEVEL) {
+		return;
+	}
+
+	struct wlr_scene_node *node =
+		wlr_scene_xdg_surface_create(&state->scene->node, xdg_surface);
+	if (node == NULL) {
+		wl_resource_post_no_memory(xdg_surface->resource);
+		return;
+	}
+
+	// Cascade the views so that they partially overlap
+	wlr_scene_node_set_position(node, 32 * (state->views % 16),
+		24 * (state->views % 16));
+	state->views++;
+}
+
+static int compare_int64(const void *_a, const void *_b) {
+	const int64_t *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+static void print_results(struct bench_state *state,
+		const struct bench_client_stats *stats) {
+	int frames = state->frames;
+	double elapsed = timespec_diff_ns(&state->last_frame, &state->start) / 1e9;
+	if (frames < 2 || elapsed <= 0) {
+		fprintf(stderr, "Not enough frames rendered\n");
+		return;
+	}
+
+	printf("frames:            %d in %.3f s (%.1f frames/s)\n",
+		frames, elapsed, frames / elapsed);
+	printf("surface commits:   %" PRIu64 " (%.1f commits/s)\n",
+		stats->commits, stats->commits / elapsed);
+	printf("frame callbacks:   %" PRIu64 "\n", stats->frames);
+	printf("popups mapped:     %" PRIu64 "\n", stats->popups);
+	printf("pointer motions:   %" PRIu64 " received by clients\n",
+		stats->pointer_motions);
+
+	size_t len = frames - 1;
+	qsort(state->frame_times_ns, len, sizeof(int64_t), compare_int64);
+	printf("frame time:        p50 %.3f ms, p90 %.3f ms, p99 %.3f ms, "
+		"max %.3f ms\n",
+		state->frame_times_ns[len * 50 / 100] / 1e6,
+		state->frame_times_ns[len * 90 / 100] / 1e6,
+		state->frame_times_ns[len * 99 / 100] / 1e6,
+		state->frame_times_ns[len - 1] / 1e6);
+
+	if (state->output_timing != NULL) {
+		struct wlr_output_timing_histogram *render =
+			&state->output_timing->render;
+		printf("render time:       p50 %.3f ms, p90 %.3f ms, p99 %.3f ms\n",
+			wlr_output_timing_histogram_percentile(render, 50) / 1e6,
+			wlr_output_timing_histogram_percentile(render, 90) / 1e6,
+			wlr_output_timing_histogram_percentile(render, 99) / 1e6);
+	}
+
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		printf("max RSS:           %ld KiB\n", usage.ru_maxrss);
+	}
+}
+
+static const char usage[] =
+	"usage: bench [options]\n"
+	"  -c <clients>     number of clients (default: 4)\n"
+	"  -s <count>       sub-surfaces per client (default: 3)\n"
+	"  -p <interval>    frames between popup re-creations, 0 to disable "
+		"(default: 10)\n"
+	"  -m <count>       pointer motion events per frame (default: 8)\n"
+	"  -f <frames>      number of frames to render (default: 1000)\n"
+	"  -h               show this help message\n";
+
+int main(int argc, char *argv[]) {
+	int clients_len = 4;
+	struct bench_client_options client_options = {
+		.width = 400,
+		.height = 300,
+		.subsurfaces = 3,
+		.popup_interval = 10,
+	};
+	struct bench_state state = {
+		.frames_target = 1000,
+		.pointer_motions_per_frame = 8,
+	};
+
+	int c;
+	while ((c = getopt(argc, argv, "c:s:p:m:f:h")) != -1) {
+		switch (c) {
+		case 'c':
+			clients_len = atoi(optarg);
+			break;
+		case 's':
+			client_options.subsurfaces = atoi(optarg);
+			break;
+		case 'p':
+			client_options.popup_interval = atoi(optarg);
+			break;
+		case 'm':
+			state.pointer_motions_per_frame = atoi(optarg);
+			break;
+		case 'f':
+			state.frames_target = atoi(optarg);
+			break;
+		default:
+			fprintf(stderr, "%s", usage);
+			return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (clients_len < 1 || state.frames_target < 2) {
+		fprintf(stderr, "%s", usage);
+		return EXIT_FAILURE;
+	}
+
+	wlr_log_init(WLR_ERROR, NULL);
+
+	state.frame_times_ns = calloc(state.frames_target, sizeof(int64_t));
+	if (state.frame_times_ns == NULL) {
+		return EXIT_FAILURE;
+	}
+
+	state.display = wl_display_create();
+	state.backend = wlr_headless_backend_create(state.display);
+	if (state.backend == NULL) {
+		return EXIT_FAILURE;
+	}
+	wlr_headless_backend_set_clock_mode(state.backend,
+		WLR_HEADLESS_CLOCK_UNTHROTTLED);
+	wlr_headless_add_output(state.backend, 1280, 720);
+
+	state.renderer = wlr_backend_get_renderer(state.backend);
+	wlr_renderer_init_wl_display(state.renderer, state.display);
+	wlr_compositor_create(state.display, state.renderer);
+
+	state.layout = wlr_output_layout_create();
+	state.scene = wlr_scene_create();
+
+	state.xdg_shell = wlr_xdg_shell_create(state.display);
+	state.new_xdg_surface.notify = handle_new_xdg_surface;
+	wl_signal_add(&state.xdg_shell->events.new_surface,
+		&state.new_xdg_surface);
+
+	state.seat = wlr_seat_create(state.display, "seat0");
+	wlr_seat_set_capabilities(state.seat, WL_SEAT_CAPABILITY_POINTER);
+	state.cursor = wlr_cursor_create();
+	wlr_cursor_attach_output_layout(state.cursor, state.layout);
+
+	state.new_output.notify = handle_new_output;
+	wl_signal_add(&state.backend->events.new_output, &state.new_output);
+
+	if (!wlr_backend_start(state.backend)) {
+		wlr_backend_destroy(state.backend);
+		return EXIT_FAILURE;
+	}
+
+	int *client_fds = calloc(clients_len, sizeof(int));
+	if (client_fds == NULL) {
+		return EXIT_FAILURE;
+	}
+	for (int i = 0; i < clients_len; i++) {
+		int sv[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) != 0) {
+			perror("socketpair failed");
+			return EXIT_FAILURE;
+		}
+		if (wl_client_create(state.display, sv[0]) == NULL) {
+			return EXIT_FAILURE;
+		}
+		client_fds[i] = sv[1];
+	}
+
+	struct bench_clients *clients =
+		bench_clients_start(client_fds, clients_len, &client_options);
+	free(client_fds);
+	if (clients == NULL) {
+		fprintf(stderr, "Failed to start clients\n");
+		return EXIT_FAILURE;
+	}
+
+	wl_display_run(state.display);
+
+	struct bench_client_stats stats;
+	bench_clients_stop(clients, &stats);
+	print_results(&state, &stats);
+
+	wl_display_destroy_clients(state.display);
+	wlr_cursor_destroy(state.cursor);
+	wlr_output_layout_destroy(state.layout);
+	wl_display_destroy(state.display);
+	free(state.frame_times_ns);
+	return EXIT_SUCCESS;
+}
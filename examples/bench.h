@@ -0,0 +1,36 @@
+#ifndef EXAMPLES_BENCH_H
+#define EXAMPLES_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct bench_client_options {
+	int width, height; // size of the toplevel surfaces
+	int subsurfaces; // number of sub-surfaces per toplevel
+	int popup_interval; // frames between popup re-creations, 0 to disable
+};
+
+struct bench_client_stats {
+	uint64_t commits; // wl_surface.commit requests
+	uint64_t frames; // frame callbacks received
+	uint64_t pointer_motions; // wl_pointer.motion events received
+	uint64_t popups; // popups mapped
+};
+
+struct bench_clients;
+
+/**
+ * Run synthetic clients in a separate thread, one per connected socket file
+ * descriptor. Each client maps an xdg_toplevel with sub-surfaces and redraws
+ * all of its surfaces from shared memory buffers on every frame callback.
+ */
+struct bench_clients *bench_clients_start(const int *fds, size_t fds_len,
+	const struct bench_client_options *options);
+/**
+ * Stop the clients, wait for the thread to exit and collect the statistics of
+ * all clients.
+ */
+void bench_clients_stop(struct bench_clients *clients,
+	struct bench_client_stats *stats);
+
+#endif
@@ -20,6 +20,9 @@ struct wlr_headless_backend {
 	struct wl_listener renderer_destroy;
 	bool has_parent_renderer;
 	bool started;
+
+	enum wlr_headless_clock_mode clock_mode;
+	int64_t clock_ns; // virtual clock, CLOCK_MONOTONIC-based
 };
 
 struct wlr_headless_output {
@@ -33,6 +36,21 @@ struct wlr_headless_output {
 
 	struct wl_event_source *frame_timer;
 	int frame_delay; // ms
+
+	// Virtual clock state
+	int64_t next_vblank_ns;
+	unsigned vblank_seq;
+	bool present_pending;
+	uint32_t present_commit_seq;
+	struct wl_event_source *idle_frame;
+
+	// Frame capture state
+	int capture_fd; // -1 if disabled
+	bool capture_damaged_only;
+	int capture_width, capture_height;
+	uint32_t *capture_pixels; // XRGB8888
+	uint8_t *capture_frame; // planar YUV 4:4:4
+	bool capture_pending;
 };
 
 struct wlr_headless_input_device {
@@ -43,5 +61,18 @@ struct wlr_headless_input_device {
 
 struct wlr_headless_backend *headless_backend_from_backend(
 	struct wlr_backend *wlr_backend);
+/**
+ * Start sending frame events according to the backend clock mode.
+ */
+void headless_output_start_clock(struct wlr_headless_output *output);
+/**
+ * Read back a committed buffer if the output is being captured. The frame is
+ * written out when headless_output_capture_present is called.
+ */
+void headless_output_capture_buffer(struct wlr_headless_output *output,
+	struct wlr_buffer *buffer);
+void headless_output_capture_present(struct wlr_headless_output *output,
+	const struct timespec *when);
+void headless_output_finish_capture(struct wlr_headless_output *output);
 
 #endif
@@ -44,6 +44,8 @@ struct wlr_wl_backend {
 	struct zwp_tablet_manager_v2 *tablet_manager;
 	struct wlr_drm_format_set linux_dmabuf_v1_formats;
 	struct wl_drm *legacy_drm;
+	struct wl_shm *shm;
+	struct wlr_drm_format_set shm_formats;
 	char *drm_render_name;
 };
 
@@ -7,6 +7,7 @@
 #include <wlr/render/drm_format_set.h>
 
 struct wlr_allocator;
+struct wlr_renderer;
 
 struct wlr_allocator_interface {
 	struct wlr_buffer *(*create_buffer)(struct wlr_allocator *alloc,
@@ -17,11 +18,24 @@ struct wlr_allocator_interface {
 struct wlr_allocator {
 	const struct wlr_allocator_interface *impl;
 
+	// Capabilities of the buffers created with this allocator
+	uint32_t buffer_caps;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
 };
 
+/**
+ * Creates the adequate wlr_allocator given a renderer and an optional DRM FD.
+ *
+ * A GBM allocator is created if the renderer supports DMA-BUFs and drm_fd is
+ * valid (the FD is duplicated, the caller keeps ownership). Otherwise, a
+ * shared memory allocator is created if the renderer supports data pointer
+ * access.
+ */
+struct wlr_allocator *allocator_autocreate_with_drm_fd(
+	struct wlr_renderer *renderer, int drm_fd);
 /**
  * Destroy the allocator.
  */
@@ -37,6 +51,6 @@ struct wlr_buffer *wlr_allocator_create_buffer(struct wlr_allocator *alloc,
 
 // For wlr_allocator implementors
 void wlr_allocator_init(struct wlr_allocator *alloc,
-	const struct wlr_allocator_interface *impl);
+	const struct wlr_allocator_interface *impl, uint32_t buffer_caps);
 
 #endif
@@ -20,6 +20,39 @@ struct wlr_gles2_pixel_format {
 	bool has_alpha;
 };
 
+// Number of pixel buffer objects used to stream texture uploads
+#define WLR_GLES2_UPLOAD_RING_LEN 4
+
+/**
+ * A persistently-mapped pixel buffer object used to stage texture uploads.
+ */
+struct wlr_gles2_upload_buffer {
+	GLuint pbo;
+	size_t size;
+	void *data;
+	EGLSyncKHR fence; // EGL_NO_SYNC_KHR if the GPU is done reading
+};
+
+/**
+ * A draw call of a batch: quads sharing the same texture and parameters.
+ */
+struct wlr_gles2_batch_draw {
+	struct wlr_gles2_texture *texture;
+	float alpha;
+	// Scissor box for quads which can't be clipped by adjusting their vertices
+	bool has_clip;
+	struct wlr_box clip;
+	// Area of the framebuffer affected by the draw call
+	struct wlr_box bounds;
+	size_t quads_len;
+	size_t first_vertex, vertices_len; // only valid while flushing
+};
+
+struct wlr_gles2_batch_quad {
+	size_t draw; // index in the draws array
+	GLfloat vertices[6][4]; // x, y, s, t for two triangles
+};
+
 struct wlr_gles2_tex_shader {
 	GLuint program;
 	GLint proj;
@@ -38,11 +71,17 @@ struct wlr_gles2_renderer {
 	int drm_fd;
 
 	const char *exts_str;
+	int gl_major_version; // 0 if unknown
+	char *program_cache_dir; // only set while creating the renderer
 	struct {
 		bool read_format_bgra_ext;
 		bool debug_khr;
 		bool egl_image_external_oes;
 		bool egl_image_oes;
+		bool pixel_buffer_object;
+		bool buffer_storage_ext;
+		bool mapbuffer_oes;
+		bool get_program_binary_oes;
 	} exts;
 
 	struct {
@@ -52,6 +91,11 @@ struct wlr_gles2_renderer {
 		PFNGLPOPDEBUGGROUPKHRPROC glPopDebugGroupKHR;
 		PFNGLPUSHDEBUGGROUPKHRPROC glPushDebugGroupKHR;
 		PFNGLEGLIMAGETARGETRENDERBUFFERSTORAGEOESPROC glEGLImageTargetRenderbufferStorageOES;
+		PFNGLBUFFERSTORAGEEXTPROC glBufferStorageEXT;
+		PFNGLMAPBUFFERRANGEEXTPROC glMapBufferRangeEXT;
+		PFNGLUNMAPBUFFEROESPROC glUnmapBufferOES;
+		PFNGLGETPROGRAMBINARYOESPROC glGetProgramBinaryOES;
+		PFNGLPROGRAMBINARYOESPROC glProgramBinaryOES;
 	} procs;
 
 	struct {
@@ -67,9 +111,21 @@ struct wlr_gles2_renderer {
 	} shaders;
 
 	struct wl_list buffers; // wlr_gles2_buffer.link
+	struct wl_list readbacks; // wlr_gles2_readback.link
 
 	struct wlr_gles2_buffer *current_buffer;
 	uint32_t viewport_width, viewport_height;
+
+	struct {
+		struct wl_array draws; // struct wlr_gles2_batch_draw
+		struct wl_array quads; // struct wlr_gles2_batch_quad
+		struct wl_array vertices; // GLfloat
+		GLuint vbo;
+	} batch;
+
+	// Only used if exts.pixel_buffer_object and exts.buffer_storage_ext are set
+	struct wlr_gles2_upload_buffer upload_buffers[WLR_GLES2_UPLOAD_RING_LEN];
+	size_t upload_buffer_idx;
 };
 
 struct wlr_gles2_buffer {
@@ -103,6 +159,69 @@ struct wlr_gles2_texture {
 	uint32_t drm_format; // used to interpret upload data
 };
 
+/**
+ * Get an idle upload buffer from the ring, with at least the specified size.
+ * Returns NULL if streaming uploads are unsupported or if the next buffer is
+ * still being read by the GPU. Must be called with the EGL context current.
+ */
+struct wlr_gles2_upload_buffer *gles2_get_upload_buffer(
+	struct wlr_gles2_renderer *renderer, size_t size);
+/**
+ * Mark the upload buffer as in use by the GPU, until all previously submitted
+ * commands complete.
+ */
+void gles2_upload_buffer_fence(struct wlr_gles2_renderer *renderer,
+	struct wlr_gles2_upload_buffer *buffer);
+
+struct wlr_gles2_readback {
+	struct wlr_render_readback base;
+	struct wlr_gles2_renderer *renderer; // NULL once the renderer is destroyed
+	struct wl_list link; // wlr_gles2_renderer.readbacks
+
+	const struct wlr_gles2_pixel_format *fmt;
+	uint32_t pack_stride;
+	GLuint pbo;
+	EGLSyncKHR fence;
+	int fence_fd; // -1 if EGL_ANDROID_native_fence_sync is unsupported
+};
+
+struct wlr_render_readback *gles2_read_pixels_async(
+	struct wlr_gles2_renderer *renderer, uint32_t drm_format,
+	uint32_t width, uint32_t height, uint32_t src_x, uint32_t src_y);
+/**
+ * Releases the GL resources of a readback and detaches it from its renderer.
+ * The readback itself stays valid and fails to copy afterwards. Must be
+ * called with the EGL context current.
+ */
+void gles2_readback_release(struct wlr_gles2_readback *readback);
+
+/**
+ * Returns the directory where linked program binaries are cached, or NULL if
+ * the cache is disabled.
+ */
+char *gles2_get_program_cache_dir(void);
+/**
+ * Loads a program from the on-disk cache. Returns 0 if the program isn't
+ * cached or if the cached binary is rejected by the driver.
+ */
+GLuint gles2_program_cache_load(struct wlr_gles2_renderer *renderer,
+	const GLchar *vert_src, const GLchar *frag_src);
+void gles2_program_cache_store(struct wlr_gles2_renderer *renderer,
+	GLuint prog, const GLchar *vert_src, const GLchar *frag_src);
+
+struct wlr_gles2_tex_shader *gles2_get_tex_shader(
+	struct wlr_gles2_renderer *renderer, struct wlr_gles2_texture *texture);
+
+bool gles2_batch_add(struct wlr_gles2_renderer *renderer,
+	struct wlr_gles2_texture *texture, const struct wlr_fbox *box,
+	const float matrix[static 9], float alpha, const struct wlr_box *clip);
+/**
+ * Submit queued quads. Must be called with the EGL context current, before
+ * any other rendering operation.
+ */
+void gles2_batch_flush(struct wlr_gles2_renderer *renderer);
+void gles2_batch_finish(struct wlr_gles2_renderer *renderer);
+
 const struct wlr_gles2_pixel_format *get_gles2_format_from_drm(uint32_t fmt);
 const struct wlr_gles2_pixel_format *get_gles2_format_from_gl(
 	GLint gl_format, GLint gl_type, bool alpha);
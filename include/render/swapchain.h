@@ -5,12 +5,19 @@
 #include <wayland-server-core.h>
 #include <wlr/render/drm_format_set.h>
 
-#define WLR_SWAPCHAIN_CAP 4
+#define WLR_SWAPCHAIN_CAP 8
+// Buffers are released after being left unused for this many frames, as long
+// as at least WLR_SWAPCHAIN_MIN_BUFFERS remain allocated
+#define WLR_SWAPCHAIN_IDLE_FRAMES 120
+#define WLR_SWAPCHAIN_MIN_BUFFERS 2
+// Max number of buffers of other sizes kept around after a resize
+#define WLR_SWAPCHAIN_POOL_CAP 4
 
 struct wlr_swapchain_slot {
 	struct wlr_buffer *buffer;
 	bool acquired; // waiting for release
 	int age;
+	int idle_frames; // submitted frames since the buffer was last acquired
 
 	struct wl_listener release;
 };
@@ -22,6 +29,8 @@ struct wlr_swapchain {
 	struct wlr_drm_format *format;
 
 	struct wlr_swapchain_slot slots[WLR_SWAPCHAIN_CAP];
+	// Idle buffers of previous sizes, most recently used first
+	struct wlr_buffer *pool[WLR_SWAPCHAIN_POOL_CAP];
 
 	struct wl_listener allocator_destroy;
 };
@@ -30,6 +39,15 @@ struct wlr_swapchain *wlr_swapchain_create(
 	struct wlr_allocator *alloc, int width, int height,
 	const struct wlr_drm_format *format);
 void wlr_swapchain_destroy(struct wlr_swapchain *swapchain);
+/**
+ * Change the size of the buffers returned by the swap chain.
+ *
+ * Idle buffers of the previous size are kept in a small pool, so that they
+ * can be reused without re-allocating if the swap chain is resized back.
+ * Buffers still acquired are released once their user unlocks them.
+ */
+void wlr_swapchain_resize(struct wlr_swapchain *swapchain,
+	int width, int height);
 /**
  * Acquire a buffer from the swap chain.
  *
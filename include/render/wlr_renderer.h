@@ -5,6 +5,10 @@
 
 /**
  * Automatically select and create a renderer suitable for the DRM FD.
+ *
+ * The WLR_RENDERER environment variable can be used to force a renderer. If
+ * the DRM FD is negative or a hardware-accelerated renderer can't be created,
+ * a pixman software renderer is returned instead.
  */
 struct wlr_renderer *wlr_renderer_autocreate_with_drm_fd(int drm_fd);
 /**
@@ -16,10 +20,16 @@ struct wlr_renderer *wlr_renderer_autocreate_with_drm_fd(int drm_fd);
  */
 bool wlr_renderer_bind_buffer(struct wlr_renderer *r, struct wlr_buffer *buffer);
 /**
- * Get the DMA-BUF formats supporting rendering usage. Buffers allocated with
- * a format from this list may be attached via wlr_renderer_bind_buffer.
+ * Get the formats supporting rendering usage. Buffers allocated with a format
+ * from this list may be attached via wlr_renderer_bind_buffer.
  */
-const struct wlr_drm_format_set *wlr_renderer_get_dmabuf_render_formats(
+const struct wlr_drm_format_set *wlr_renderer_get_render_formats(
 	struct wlr_renderer *renderer);
+/**
+ * Get the supported render buffer capabilities, a bitmask of
+ * enum wlr_buffer_cap. Buffers bound via wlr_renderer_bind_buffer must
+ * support at least one of these capabilities.
+ */
+uint32_t renderer_get_render_buffer_caps(struct wlr_renderer *renderer);
 
 #endif
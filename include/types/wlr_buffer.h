@@ -0,0 +1,54 @@
+#ifndef TYPES_WLR_BUFFER_H
+#define TYPES_WLR_BUFFER_H
+
+#include <wlr/types/wlr_buffer.h>
+
+/**
+ * Buffer capabilities.
+ *
+ * These bits indicate the features supported by a wlr_buffer. There is one
+ * bit per function in wlr_buffer_impl.
+ */
+enum wlr_buffer_cap {
+	WLR_BUFFER_CAP_DATA_PTR = 1 << 0,
+	WLR_BUFFER_CAP_DMABUF = 1 << 1,
+	WLR_BUFFER_CAP_SHM = 1 << 2,
+};
+
+/**
+ * Access a pointer to the allocated data from the underlying implementation,
+ * and its format and stride.
+ *
+ * The returned pointer is valid for read and write operations until
+ * buffer_end_data_ptr_access is called.
+ */
+bool buffer_begin_data_ptr_access(struct wlr_buffer *buffer, void **data,
+	uint32_t *format, size_t *stride);
+void buffer_end_data_ptr_access(struct wlr_buffer *buffer);
+
+/**
+ * A wl_shm buffer, accessed in place. The backing storage is kept mapped even
+ * if the client destroys the wl_buffer.
+ */
+struct wlr_shm_client_buffer {
+	struct wlr_buffer base;
+
+	uint32_t format;
+	size_t stride;
+
+	// The following fields are NULL if the client has destroyed the wl_buffer
+	struct wl_resource *resource;
+	struct wl_shm_buffer *shm_buffer;
+
+	// This is used to keep the backing storage alive after the client has
+	// destroyed the wl_buffer
+	struct wl_shm_pool *saved_shm_pool;
+	void *saved_data;
+
+	struct wl_listener resource_destroy;
+};
+
+struct wlr_shm_client_buffer *shm_client_buffer_create(
+	struct wl_resource *resource);
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef TYPES_WLR_LINUX_DMABUF_V1_H
+#define TYPES_WLR_LINUX_DMABUF_V1_H
+
+#include <wlr/types/wlr_linux_dmabuf_v1.h>
+
+/**
+ * Get the texture imported from the buffer with its renderer, importing it if
+ * necessary. The texture is shared by all users of the buffer and stays valid
+ * until dmabuf_v1_buffer_unref_texture is called, even if the wl_buffer is
+ * destroyed in the meantime.
+ */
+struct wlr_texture *dmabuf_v1_buffer_ref_texture(
+	struct wlr_dmabuf_v1_buffer *buffer);
+void dmabuf_v1_buffer_unref_texture(struct wlr_dmabuf_v1_buffer *buffer);
+
+#endif
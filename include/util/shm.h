@@ -3,5 +3,11 @@
 
 int create_shm_file(void);
 int allocate_shm_file(size_t size);
+/**
+ * Allocate a shared memory file holding a copy of data, sealed against any
+ * further modification so that it can be shared with untrusted processes.
+ * Returns -1 if sealing isn't supported.
+ */
+int allocate_sealed_shm_file(const void *data, size_t size);
 
 #endif
@@ -0,0 +1,54 @@
+#ifndef UTIL_TRACE_H
+#define UTIL_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Tracing helpers. Event names and argument names must be string literals,
+ * only their address is recorded. When wlroots is built without tracing
+ * support, these compile to nothing.
+ */
+
+#if HAS_TRACING
+
+extern bool trace_enabled;
+
+void trace_record(char phase, const char *name, const char *arg_name,
+	int64_t arg);
+
+/**
+ * Begin a duration event. It must be balanced with a trace_end() call with the
+ * same name.
+ */
+#define trace_begin(name, arg_name, arg) \
+	do { \
+		if (trace_enabled) { \
+			trace_record('B', (name), (arg_name), (arg)); \
+		} \
+	} while (0)
+#define trace_end(name) \
+	do { \
+		if (trace_enabled) { \
+			trace_record('E', (name), NULL, 0); \
+		} \
+	} while (0)
+/**
+ * Record an event without duration.
+ */
+#define trace_instant(name, arg_name, arg) \
+	do { \
+		if (trace_enabled) { \
+			trace_record('i', (name), (arg_name), (arg)); \
+		} \
+	} while (0)
+
+#else
+
+#define trace_begin(name, arg_name, arg) ((void)0)
+#define trace_end(name) ((void)0)
+#define trace_instant(name, arg_name, arg) ((void)0)
+
+#endif
+
+#endif
@@ -13,6 +13,16 @@
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_output.h>
 
+enum wlr_headless_clock_mode {
+	// Frames are paced by a wall-clock timer at the output refresh rate
+	WLR_HEADLESS_CLOCK_REALTIME,
+	// Time only advances when wlr_headless_backend_advance_clock is called
+	WLR_HEADLESS_CLOCK_MANUAL,
+	// Each buffer commit is presented at the next virtual refresh, and the
+	// next frame event is sent as soon as possible
+	WLR_HEADLESS_CLOCK_UNTHROTTLED,
+};
+
 /**
  * Creates a headless backend. A headless backend has no outputs or inputs by
  * default.
@@ -30,6 +40,17 @@ struct wlr_backend *wlr_headless_backend_create_with_renderer(
  */
 struct wlr_output *wlr_headless_add_output(struct wlr_backend *backend,
 	unsigned int width, unsigned int height);
+/**
+ * Write the buffers presented on a headless output to a file descriptor, as a
+ * YUV4MPEG2 stream with 4:4:4 chroma. Each frame header carries the
+ * presentation time in nanoseconds as an `Xts` parameter.
+ *
+ * If `damaged_only` is true, buffers committed with an empty damage region are
+ * skipped. The output takes ownership of the file descriptor. Passing -1 stops
+ * the capture. The capture stops if the output is resized.
+ */
+bool wlr_headless_output_set_capture(struct wlr_output *output, int fd,
+	bool damaged_only);
 /**
  * Creates a new input device. The caller is responsible for manually raising
  * any event signals on the new input device if it wants to simulate input
@@ -37,6 +58,25 @@ struct wlr_output *wlr_headless_add_output(struct wlr_backend *backend,
  */
 struct wlr_input_device *wlr_headless_add_input_device(
 	struct wlr_backend *backend, enum wlr_input_device_type type);
+/**
+ * Set how the outputs of the backend are paced.
+ *
+ * In the virtual clock modes (all but WLR_HEADLESS_CLOCK_REALTIME), frame
+ * and present events don't depend on the wall clock: present events carry
+ * timestamps that are multiples of the refresh period, starting from the
+ * time the virtual clock was enabled, along with consecutive refresh sequence
+ * numbers. This makes frame pacing reproducible for automated tests and
+ * benchmarks.
+ */
+void wlr_headless_backend_set_clock_mode(struct wlr_backend *backend,
+	enum wlr_headless_clock_mode mode);
+/**
+ * Advance the virtual clock of a backend in the WLR_HEADLESS_CLOCK_MANUAL
+ * mode. For each refresh of an output that falls in the elapsed time, the
+ * last committed buffer is presented and a frame event is sent.
+ */
+void wlr_headless_backend_advance_clock(struct wlr_backend *backend,
+	int64_t nsec);
 bool wlr_backend_is_headless(struct wlr_backend *backend);
 bool wlr_input_device_is_headless(struct wlr_input_device *device);
 bool wlr_output_is_headless(struct wlr_output *output);
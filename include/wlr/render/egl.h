@@ -48,6 +48,8 @@ struct wlr_egl {
 		bool image_base_khr;
 		bool image_dmabuf_import_ext;
 		bool image_dmabuf_import_modifiers_ext;
+		bool fence_sync_khr;
+		bool native_fence_sync_android;
 
 		// Device extensions
 		bool device_drm_ext;
@@ -65,6 +67,10 @@ struct wlr_egl {
 		PFNEGLDEBUGMESSAGECONTROLKHRPROC eglDebugMessageControlKHR;
 		PFNEGLQUERYDISPLAYATTRIBEXTPROC eglQueryDisplayAttribEXT;
 		PFNEGLQUERYDEVICESTRINGEXTPROC eglQueryDeviceStringEXT;
+		PFNEGLCREATESYNCKHRPROC eglCreateSyncKHR;
+		PFNEGLDESTROYSYNCKHRPROC eglDestroySyncKHR;
+		PFNEGLCLIENTWAITSYNCKHRPROC eglClientWaitSyncKHR;
+		PFNEGLDUPNATIVEFENCEFDANDROIDPROC eglDupNativeFenceFDANDROID;
 	} procs;
 
 	struct wl_display *wl_display;
@@ -30,6 +30,10 @@ struct wlr_renderer_impl {
 		const float matrix[static 9], float alpha);
 	void (*render_quad_with_matrix)(struct wlr_renderer *renderer,
 		const float color[static 4], const float matrix[static 9]);
+	bool (*batch_add)(struct wlr_renderer *renderer,
+		struct wlr_texture *texture, const struct wlr_fbox *box,
+		const float matrix[static 9], float alpha, const struct wlr_box *clip);
+	void (*batch_flush)(struct wlr_renderer *renderer);
 	const uint32_t *(*get_shm_texture_formats)(struct wlr_renderer *renderer,
 		size_t *len);
 	bool (*resource_is_wl_drm_buffer)(struct wlr_renderer *renderer,
@@ -38,7 +42,7 @@ struct wlr_renderer_impl {
 		struct wl_resource *buffer, int *width, int *height);
 	const struct wlr_drm_format_set *(*get_dmabuf_texture_formats)(
 		struct wlr_renderer *renderer);
-	const struct wlr_drm_format_set *(*get_dmabuf_render_formats)(
+	const struct wlr_drm_format_set *(*get_render_formats)(
 		struct wlr_renderer *renderer);
 	uint32_t (*preferred_read_format)(struct wlr_renderer *renderer);
 	bool (*read_pixels)(struct wlr_renderer *renderer, uint32_t fmt,
@@ -52,21 +56,42 @@ struct wlr_renderer_impl {
 		struct wl_resource *data);
 	struct wlr_texture *(*texture_from_dmabuf)(struct wlr_renderer *renderer,
 		struct wlr_dmabuf_attributes *attribs);
+	struct wlr_texture *(*texture_from_buffer)(struct wlr_renderer *renderer,
+		struct wlr_buffer *buffer);
 	void (*destroy)(struct wlr_renderer *renderer);
 	bool (*init_wl_display)(struct wlr_renderer *renderer,
 		struct wl_display *wl_display);
 	int (*get_drm_fd)(struct wlr_renderer *renderer);
+	uint32_t (*get_render_buffer_caps)(struct wlr_renderer *renderer);
+	struct wlr_render_readback *(*read_pixels_async)(
+		struct wlr_renderer *renderer, uint32_t fmt, uint32_t width,
+		uint32_t height, uint32_t src_x, uint32_t src_y);
 };
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
 	const struct wlr_renderer_impl *impl);
 
+struct wlr_render_readback_impl {
+	int (*get_fd)(struct wlr_render_readback *readback);
+	bool (*is_done)(struct wlr_render_readback *readback);
+	bool (*copy)(struct wlr_render_readback *readback, uint32_t *flags,
+		uint32_t stride, void *data);
+	void (*destroy)(struct wlr_render_readback *readback);
+};
+
+void wlr_render_readback_init(struct wlr_render_readback *readback,
+	const struct wlr_render_readback_impl *impl, uint32_t format,
+	uint32_t width, uint32_t height);
+
 struct wlr_texture_impl {
 	bool (*is_opaque)(struct wlr_texture *texture);
 	bool (*write_pixels)(struct wlr_texture *texture,
 		uint32_t stride, uint32_t width, uint32_t height,
 		uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y,
 		const void *data);
+	bool (*write_pixels_region)(struct wlr_texture *texture,
+		uint32_t stride, pixman_region32_t *region, const void *data);
+	void (*invalidate)(struct wlr_texture *texture);
 	void (*destroy)(struct wlr_texture *texture);
 };
 
@@ -20,19 +20,38 @@ enum wlr_renderer_read_pixels_flags {
 };
 
 struct wlr_renderer_impl;
+struct wlr_render_readback_impl;
 struct wlr_drm_format_set;
 struct wlr_buffer;
 
+/**
+ * An asynchronous read of pixels, see wlr_renderer_read_pixels_async.
+ */
+struct wlr_render_readback {
+	const struct wlr_render_readback_impl *impl;
+
+	uint32_t format;
+	uint32_t width, height;
+};
+
 struct wlr_renderer {
 	const struct wlr_renderer_impl *impl;
 
 	bool rendering;
 
+	// Scissor box set with wlr_renderer_scissor, if any
+	bool has_scissor;
+	struct wlr_box scissor_box;
+
 	struct {
 		struct wl_signal destroy;
 	} events;
 };
 
+/**
+ * Automatically create a renderer suitable for the backend. Falls back to a
+ * software renderer if the backend doesn't expose a DRM device.
+ */
 struct wlr_renderer *wlr_renderer_autocreate(struct wlr_backend *backend);
 
 void wlr_renderer_begin(struct wlr_renderer *r, uint32_t width, uint32_t height);
@@ -61,6 +80,24 @@ bool wlr_render_texture_with_matrix(struct wlr_renderer *r,
 bool wlr_render_subtexture_with_matrix(struct wlr_renderer *r,
 	struct wlr_texture *texture, const struct wlr_fbox *box,
 	const float matrix[static 9], float alpha);
+/**
+ * Queues the requested texture for rendering using the provided matrix, after
+ * cropping it to the provided rectangle. If `clip` isn't NULL, only the pixels
+ * inside `clip` are drawn, in addition to the scissor box. `clip` uses the same
+ * coordinate space as wlr_renderer_scissor.
+ *
+ * Queued textures are drawn by wlr_render_batch_flush, which is implicitly
+ * called before any other rendering operation and by wlr_renderer_end. The
+ * renderer may reorder queued textures which don't overlap to reduce state
+ * changes. The texture must not be destroyed before the batch is flushed.
+ */
+bool wlr_render_batch_add(struct wlr_renderer *r, struct wlr_texture *texture,
+	const struct wlr_fbox *box, const float matrix[static 9], float alpha,
+	const struct wlr_box *clip);
+/**
+ * Draws all textures queued with wlr_render_batch_add.
+ */
+void wlr_render_batch_flush(struct wlr_renderer *r);
 /**
  * Renders a solid rectangle in the specified color.
  */
@@ -103,6 +140,31 @@ const struct wlr_drm_format_set *wlr_renderer_get_dmabuf_texture_formats(
 bool wlr_renderer_read_pixels(struct wlr_renderer *r, uint32_t fmt,
 	uint32_t *flags, uint32_t stride, uint32_t width, uint32_t height,
 	uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y, void *data);
+/**
+ * Starts reading out pixels of the currently bound surface, without waiting
+ * for the GPU to finish rendering. Returns NULL if the renderer doesn't support
+ * asynchronous reads, in which case wlr_renderer_read_pixels should be used.
+ */
+struct wlr_render_readback *wlr_renderer_read_pixels_async(
+	struct wlr_renderer *r, uint32_t fmt, uint32_t width, uint32_t height,
+	uint32_t src_x, uint32_t src_y);
+/**
+ * Get a file descriptor which becomes readable when the readback is complete.
+ * Returns -1 if not supported, in which case wlr_render_readback_is_done
+ * should be polled instead. The file descriptor is owned by the readback.
+ */
+int wlr_render_readback_get_fd(struct wlr_render_readback *readback);
+/**
+ * Checks whether the readback is complete, without blocking.
+ */
+bool wlr_render_readback_is_done(struct wlr_render_readback *readback);
+/**
+ * Copies the pixels of a readback into data. `stride` is in bytes. Blocks
+ * until the readback is complete. See wlr_renderer_read_pixels for `flags`.
+ */
+bool wlr_render_readback_copy(struct wlr_render_readback *readback,
+	uint32_t *flags, uint32_t stride, void *data);
+void wlr_render_readback_destroy(struct wlr_render_readback *readback);
 
 /**
  * Creates necessary shm and invokes the initialization of the implementation.
@@ -9,10 +9,12 @@
 #ifndef WLR_RENDER_WLR_TEXTURE_H
 #define WLR_RENDER_WLR_TEXTURE_H
 
+#include <pixman.h>
 #include <stdint.h>
 #include <wayland-server-core.h>
 #include <wlr/render/dmabuf.h>
 
+struct wlr_buffer;
 struct wlr_renderer;
 struct wlr_texture_impl;
 
@@ -51,6 +53,19 @@ struct wlr_texture *wlr_texture_from_wl_drm(struct wlr_renderer *renderer,
 struct wlr_texture *wlr_texture_from_dmabuf(struct wlr_renderer *renderer,
 	struct wlr_dmabuf_attributes *attribs);
 
+/**
+ * Create a new texture which directly samples from a buffer, without copying
+ * its contents. The texture locks the buffer until it's destroyed. The
+ * returned texture is immutable.
+ *
+ * Returns NULL if the renderer can't sample from the buffer directly.
+ *
+ * Should not be called in a rendering block like renderer_begin()/end() or
+ * between attaching a renderer to an output and committing it.
+ */
+struct wlr_texture *wlr_texture_from_buffer(struct wlr_renderer *renderer,
+	struct wlr_buffer *buffer);
+
 /**
  * Get the texture width and height.
  *
@@ -76,6 +91,22 @@ bool wlr_texture_write_pixels(struct wlr_texture *texture,
 	uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y,
 	const void *data);
 
+/**
+ * Update a texture with the pixels of the specified region. The data buffer
+ * covers the whole texture and uses the texture's format. All rectangles are
+ * uploaded in a single batch, implementations may stage them and perform the
+ * copy asynchronously: the data can be released as soon as this returns.
+ */
+bool wlr_texture_write_pixels_region(struct wlr_texture *texture,
+	uint32_t stride, pixman_region32_t *region, const void *data);
+
+/**
+ * Notify the renderer that the contents of the buffer backing an imported
+ * texture have changed, e.g. when a client has rendered a new frame into a
+ * DMA-BUF whose texture is reused.
+ */
+void wlr_texture_invalidate(struct wlr_texture *texture);
+
 /**
  * Destroys this wlr_texture.
  */
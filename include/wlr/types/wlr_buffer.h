@@ -10,15 +10,31 @@
 #define WLR_TYPES_WLR_BUFFER_H
 
 #include <pixman.h>
+#include <sys/types.h>
 #include <wayland-server-core.h>
 #include <wlr/render/dmabuf.h>
 
 struct wlr_buffer;
 
+/**
+ * Shared-memory attributes of a buffer.
+ */
+struct wlr_shm_attributes {
+	int fd;
+	uint32_t format;
+	int width, height, stride;
+	off_t offset;
+};
+
 struct wlr_buffer_impl {
 	void (*destroy)(struct wlr_buffer *buffer);
 	bool (*get_dmabuf)(struct wlr_buffer *buffer,
 		struct wlr_dmabuf_attributes *attribs);
+	bool (*get_shm)(struct wlr_buffer *buffer,
+		struct wlr_shm_attributes *attribs);
+	bool (*begin_data_ptr_access)(struct wlr_buffer *buffer, void **data,
+		uint32_t *format, size_t *stride);
+	void (*end_data_ptr_access)(struct wlr_buffer *buffer);
 };
 
 /**
@@ -36,6 +52,7 @@ struct wlr_buffer {
 
 	bool dropped;
 	size_t n_locks;
+	bool accessing_data_ptr;
 
 	struct {
 		struct wl_signal destroy;
@@ -76,6 +93,16 @@ void wlr_buffer_unlock(struct wlr_buffer *buffer);
  */
 bool wlr_buffer_get_dmabuf(struct wlr_buffer *buffer,
 	struct wlr_dmabuf_attributes *attribs);
+/**
+ * Read shared memory attributes of the buffer. If this buffer isn't shared
+ * memory, returns false.
+ *
+ * The returned shared memory attributes are valid for the lifetime of the
+ * wlr_buffer. The caller isn't responsible for cleaning up the shared memory
+ * attributes.
+ */
+bool wlr_buffer_get_shm(struct wlr_buffer *buffer,
+	struct wlr_shm_attributes *attribs);
 
 /**
  * A client buffer.
@@ -96,6 +123,17 @@ struct wlr_client_buffer {
 	 * client destroys the buffer before it has been released.
 	 */
 	struct wlr_texture *texture;
+	/**
+	 * The buffer the texture directly samples from, if the texture has been
+	 * imported without copying the buffer's contents. Such textures can't be
+	 * updated with wlr_client_buffer_apply_damage.
+	 */
+	struct wlr_buffer *source;
+	/**
+	 * The linux-dmabuf buffer owning the texture, if the texture is shared
+	 * with the other client buffers imported from the same wl_buffer.
+	 */
+	struct wlr_dmabuf_v1_buffer *dmabuf;
 
 	struct wl_listener resource_destroy;
 	struct wl_listener release;
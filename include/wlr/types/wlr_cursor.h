@@ -131,6 +131,35 @@ void wlr_cursor_warp_absolute(struct wlr_cursor *cur,
 void wlr_cursor_move(struct wlr_cursor *cur, struct wlr_input_device *dev,
 	double delta_x, double delta_y);
 
+/**
+ * Enable coalescing of relative pointer motion, for high polling rate input
+ * devices. Motion events of each pointer device are accumulated and emitted as
+ * a single motion event, followed by a frame event, when an output of the
+ * attached layout emits a frame event, or at the latest `interval_ms`
+ * milliseconds after the first accumulated motion event. The cursor flushes
+ * pending motion ahead of any other frame listener of the output, so that the
+ * compositor renders the frame with the updated pointer position. Unaccelerated deltas
+ * are accumulated along with the accelerated ones.
+ *
+ * Pending motion is always emitted before any other event of the cursor, so
+ * that motion stays ordered with respect to buttons, axis, gestures and other
+ * events.
+ *
+ * `loop` is used for the interval timer. An interval of 0 disables
+ * coalescing, emitting any pending motion.
+ */
+void wlr_cursor_set_motion_coalescing(struct wlr_cursor *cur,
+	struct wl_event_loop *loop, int interval_ms);
+
+/**
+ * Batch the hardware cursor position updates. When enabled, cursor movements
+ * are latched and the position of hardware cursors is only applied once per
+ * output commit, right before the commit. Outputs that the cursor is neither
+ * leaving nor entering aren't asked to render a new frame. Software cursors
+ * are still moved immediately.
+ */
+void wlr_cursor_set_batched_moves(struct wlr_cursor *cur, bool batched);
+
 /**
  * Set the cursor image. stride is given in bytes. If pixels is NULL, hides the
  * cursor.
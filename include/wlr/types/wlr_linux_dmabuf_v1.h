@@ -19,6 +19,13 @@ struct wlr_dmabuf_v1_buffer {
 	struct wl_resource *params_resource;
 	struct wlr_dmabuf_attributes attributes;
 	bool has_modifier;
+
+	// Texture imported with the renderer, shared by all commits of the buffer
+	struct wlr_texture *texture;
+	// Users of the texture, plus one while the wl_buffer resource is alive
+	size_t n_refs;
+
+	struct wl_listener renderer_destroy;
 };
 
 /**
@@ -103,6 +103,37 @@ struct wlr_output_state {
 
 struct wlr_output_impl;
 
+#define WLR_OUTPUT_FRAME_SCHEDULER_HISTORY_LEN 16
+
+/**
+ * Deadline-based frame scheduling. When enabled, the frame event following a
+ * vblank is delayed so that rendering completes right before the next vblank
+ * instead of right after the previous one. Client commits made in the
+ * meantime are picked up by the next frame, which cuts the latency between
+ * input and presentation by up to one refresh period.
+ *
+ * The render time is predicted from the time between the last frame events
+ * and the matching buffer commits.
+ */
+struct wlr_output_frame_scheduler {
+	bool enabled;
+	// Time left between the predicted end of rendering and the next vblank
+	int64_t margin_ns;
+
+	// Statistics
+	int64_t predicted_render_ns;
+	int64_t delay_ns; // delay applied to the last frame event
+	uint64_t missed_deadlines; // buffers committed after their vblank
+
+	// private state
+
+	int64_t render_ns[WLR_OUTPUT_FRAME_SCHEDULER_HISTORY_LEN];
+	size_t render_idx, render_len;
+	int64_t vblank_ns; // time of the vblank of the last frame event, or -1
+	int64_t frame_ns; // time of the last frame event, or -1 once committed
+	struct wl_event_source *timer;
+};
+
 /**
  * A compositor output region. This typically corresponds to a monitor that
  * displays part of the compositor space.
@@ -151,6 +182,8 @@ struct wlr_output {
 	// Commit sequence number. Incremented on each commit, may overflow.
 	uint32_t commit_seq;
 
+	struct wlr_output_frame_scheduler frame_scheduler;
+
 	struct {
 		// Request to render a frame
 		struct wl_signal frame;
@@ -379,6 +412,13 @@ void wlr_output_rollback(struct wlr_output *output);
  * it is a no-op.
  */
 void wlr_output_schedule_frame(struct wlr_output *output);
+/**
+ * Enable or disable deadline-based frame scheduling, see
+ * struct wlr_output_frame_scheduler. Frame events are only delayed on outputs
+ * with a known refresh rate, once enough frames have been measured.
+ */
+void wlr_output_enable_frame_scheduler(struct wlr_output *output,
+	bool enabled);
 /**
  * Returns the maximum length of each gamma ramp, or 0 if unsupported.
  */
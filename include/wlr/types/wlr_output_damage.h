@@ -15,11 +15,11 @@
 #include <wlr/types/wlr_output.h>
 
 /**
- * Damage tracking requires to keep track of previous frames' damage. To allow
- * damage tracking to work with triple buffering, a history of two frames is
- * required.
+ * Damage tracking requires to keep track of previous frames' damage. A buffer
+ * of age N needs the damage of the N - 1 previous frames, so the history
+ * covers every buffer of a full output swapchain (8 buffers).
  */
-#define WLR_OUTPUT_DAMAGE_PREVIOUS_LEN 2
+#define WLR_OUTPUT_DAMAGE_PREVIOUS_LEN 7
 
 /**
  * Tracks damage for an output.
@@ -35,6 +35,9 @@
 struct wlr_output_damage {
 	struct wlr_output *output;
 	int max_rects; // max number of damaged rectangles
+	// max extra area, relative to the damaged area, that may be added when
+	// merging damaged rectangles
+	float max_waste;
 
 	pixman_region32_t current; // in output-local coordinates
 
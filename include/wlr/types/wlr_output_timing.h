@@ -0,0 +1,107 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_OUTPUT_TIMING_H
+#define WLR_TYPES_WLR_OUTPUT_TIMING_H
+
+#include <stdint.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+
+/**
+ * Number of samples kept by each histogram.
+ */
+#define WLR_OUTPUT_TIMING_HISTORY_LEN 256
+/**
+ * Histogram buckets are one millisecond wide, the last one counts all samples
+ * above.
+ */
+#define WLR_OUTPUT_TIMING_BUCKET_LEN 34
+#define WLR_OUTPUT_TIMING_PENDING_LEN 8
+
+/**
+ * A histogram of the last WLR_OUTPUT_TIMING_HISTORY_LEN samples of a duration.
+ */
+struct wlr_output_timing_histogram {
+	int64_t samples[WLR_OUTPUT_TIMING_HISTORY_LEN]; // nanoseconds
+	size_t samples_idx, samples_len;
+
+	// Number of samples in the window, by duration in milliseconds
+	size_t buckets[WLR_OUTPUT_TIMING_BUCKET_LEN];
+};
+
+/**
+ * Tracks frame timings for an output.
+ *
+ * Durations are collected from the output's frame, commit and present events
+ * into rolling histograms:
+ *
+ * - `latency`: from a buffer commit to its presentation. Only available if the
+ *   backend presentation clock is CLOCK_MONOTONIC.
+ * - `render`: from a frame event to the buffer commit that follows.
+ * - `interval`: between two consecutive presentations, while the compositor
+ *   keeps committing new frames.
+ */
+struct wlr_output_timing {
+	struct wlr_output *output;
+
+	struct wlr_output_timing_histogram latency;
+	struct wlr_output_timing_histogram render;
+	struct wlr_output_timing_histogram interval;
+
+	uint64_t presented; // number of presented frames
+	// Number of vertical refreshes skipped between two consecutive frames
+	uint64_t missed_vblanks;
+
+	struct {
+		struct wl_signal destroy;
+	} events;
+
+	// private state
+
+	// circular queue of the times of the last buffer commits, the entry at
+	// pending_idx is the commit in progress, if any
+	struct {
+		uint32_t commit_seq;
+		struct timespec when;
+	} pending[WLR_OUTPUT_TIMING_PENDING_LEN];
+	size_t pending_idx;
+
+	bool frame_valid;
+	struct timespec frame; // time of the last frame event
+	bool present_valid;
+	struct timespec present; // time of the last presentation
+
+	struct wl_listener output_destroy;
+	struct wl_listener output_frame;
+	struct wl_listener output_precommit;
+	struct wl_listener output_commit;
+	struct wl_listener output_present;
+};
+
+struct wlr_output_timing *wlr_output_timing_create(struct wlr_output *output);
+void wlr_output_timing_destroy(struct wlr_output_timing *output_timing);
+/**
+ * Clear all collected samples and counters.
+ */
+void wlr_output_timing_reset(struct wlr_output_timing *output_timing);
+/**
+ * Get the duration below which `percentile` percent of the samples of the
+ * histogram fall, in nanoseconds. Returns -1 if the histogram is empty.
+ */
+int64_t wlr_output_timing_histogram_percentile(
+	const struct wlr_output_timing_histogram *histogram, double percentile);
+/**
+ * Write a summary of the collected timings to the log.
+ */
+void wlr_output_timing_log(struct wlr_output_timing *output_timing,
+	enum wlr_log_importance verbosity);
+
+#endif
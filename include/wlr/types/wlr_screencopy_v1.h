@@ -10,6 +10,7 @@
 #define WLR_TYPES_WLR_SCREENCOPY_V1_H
 
 #include <stdbool.h>
+#include <time.h>
 #include <wayland-server-core.h>
 #include <wlr/types/wlr_box.h>
 
@@ -51,6 +52,13 @@ struct wlr_screencopy_frame_v1 {
 
 	struct wl_listener buffer_destroy;
 
+	// Pending asynchronous copy into shm_buffer
+	struct wlr_render_readback *readback;
+	struct wl_event_source *readback_source;
+	struct timespec readback_when;
+	struct wlr_box readback_damage;
+	bool readback_has_damage;
+
 	struct wlr_output *output;
 	struct wl_listener output_precommit;
 	struct wl_listener output_commit;
@@ -52,6 +52,10 @@ struct wlr_seat_client {
 	// set of serials which were sent to the client on this seat
 	// for use by wlr_seat_client_{next_serial,validate_event_serial}
 	struct wlr_serial_ringset serials;
+
+	// private state
+
+	struct wl_list bucket_link; // wlr_seat::client_buckets
 };
 
 struct wlr_touch_point {
@@ -242,6 +246,12 @@ struct wlr_seat {
 	struct wl_listener primary_selection_source_destroy;
 	struct wl_listener drag_source_destroy;
 
+	// private state
+
+	// hash table of wlr_seat_client::bucket_link, indexed by wl_client
+	struct wl_list *client_buckets;
+	size_t client_buckets_len, clients_len;
+
 	struct {
 		struct wl_signal pointer_grab_begin;
 		struct wl_signal pointer_grab_end;
@@ -53,6 +53,19 @@ void wlr_region_expand(pixman_region32_t *dst, pixman_region32_t *src,
 void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 	float rotation, int ox, int oy);
 
+/**
+ * Reduces the number of rectangles in a region by merging neighbouring
+ * rectangles into their bounding box. The resulting region always contains the
+ * original one.
+ *
+ * Rectangles are merged as long as the total added area stays below
+ * `max_waste` times the area of the original region. Merging continues past
+ * this budget until the region has at most `max_rects` rectangles, if
+ * `max_rects` is positive.
+ */
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+	int max_rects, float max_waste);
+
 bool wlr_region_confine(pixman_region32_t *region, double x1, double y1, double x2,
 	double y2, double *x2_out, double *y2_out);
 
@@ -0,0 +1,39 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_UTIL_TRACE_H
+#define WLR_UTIL_TRACE_H
+
+#include <stdbool.h>
+
+/**
+ * wlroots can record a timeline of the events involved in displaying a frame:
+ * surface commits, output frame events, rendering, output commits, page-flips
+ * and presentation feedback. Events are kept in a fixed-size ring buffer, the
+ * oldest ones are overwritten.
+ *
+ * Tracing is only available if wlroots has been built with the `tracing`
+ * option.
+ */
+
+/**
+ * Start or stop recording events. Returns false if wlroots has been built
+ * without tracing support, or if the event buffer cannot be allocated.
+ */
+bool wlr_trace_set_enabled(bool enabled);
+/**
+ * Discard all recorded events.
+ */
+void wlr_trace_clear(void);
+/**
+ * Write the recorded events to a file in the Chrome trace event format, which
+ * can be loaded in chrome://tracing or Perfetto.
+ */
+bool wlr_trace_dump(const char *path);
+
+#endif
@@ -1,14 +1,55 @@
+#define _POSIX_C_SOURCE 200809L
 #include <assert.h>
+#include <fcntl.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
 #include "render/allocator.h"
+#include "render/gbm_allocator.h"
+#include "render/shm_allocator.h"
+#include "render/wlr_renderer.h"
+#include "types/wlr_buffer.h"
 
 void wlr_allocator_init(struct wlr_allocator *alloc,
-		const struct wlr_allocator_interface *impl) {
+		const struct wlr_allocator_interface *impl, uint32_t buffer_caps) {
 	assert(impl && impl->destroy && impl->create_buffer);
 	alloc->impl = impl;
+	alloc->buffer_caps = buffer_caps;
 	wl_signal_init(&alloc->events.destroy);
 }
 
+struct wlr_allocator *allocator_autocreate_with_drm_fd(
+		struct wlr_renderer *renderer, int drm_fd) {
+	uint32_t renderer_caps = renderer_get_render_buffer_caps(renderer);
+
+	if ((renderer_caps & WLR_BUFFER_CAP_DMABUF) && drm_fd >= 0) {
+		wlr_log(WLR_DEBUG, "Trying to create GBM allocator");
+		int gbm_fd = fcntl(drm_fd, F_DUPFD_CLOEXEC, 0);
+		if (gbm_fd < 0) {
+			wlr_log_errno(WLR_ERROR, "fcntl(F_DUPFD_CLOEXEC) failed");
+			return NULL;
+		}
+		struct wlr_gbm_allocator *gbm_alloc = wlr_gbm_allocator_create(gbm_fd);
+		if (gbm_alloc != NULL) {
+			return &gbm_alloc->base;
+		}
+		close(gbm_fd);
+		wlr_log(WLR_DEBUG, "Failed to create GBM allocator");
+	}
+
+	if (renderer_caps & WLR_BUFFER_CAP_DATA_PTR) {
+		wlr_log(WLR_DEBUG, "Trying to create shared memory allocator");
+		struct wlr_shm_allocator *shm_alloc = wlr_shm_allocator_create();
+		if (shm_alloc != NULL) {
+			return &shm_alloc->base;
+		}
+		wlr_log(WLR_DEBUG, "Failed to create shared memory allocator");
+	}
+
+	wlr_log(WLR_ERROR, "Failed to create allocator");
+	return NULL;
+}
+
 void wlr_allocator_destroy(struct wlr_allocator *alloc) {
 	if (alloc == NULL) {
 		return;
@@ -241,6 +241,20 @@ struct wlr_egl *wlr_egl_create(EGLenum platform, void *remote_display) {
 			"eglQueryDmaBufModifiersEXT");
 	}
 
+	if (check_egl_ext(display_exts_str, "EGL_KHR_fence_sync")) {
+		egl->exts.fence_sync_khr = true;
+		load_egl_proc(&egl->procs.eglCreateSyncKHR, "eglCreateSyncKHR");
+		load_egl_proc(&egl->procs.eglDestroySyncKHR, "eglDestroySyncKHR");
+		load_egl_proc(&egl->procs.eglClientWaitSyncKHR,
+			"eglClientWaitSyncKHR");
+
+		if (check_egl_ext(display_exts_str, "EGL_ANDROID_native_fence_sync")) {
+			egl->exts.native_fence_sync_android = true;
+			load_egl_proc(&egl->procs.eglDupNativeFenceFDANDROID,
+				"eglDupNativeFenceFDANDROID");
+		}
+	}
+
 	if (check_egl_ext(display_exts_str, "EGL_WL_bind_wayland_display")) {
 		egl->exts.bind_wayland_display_wl = true;
 		load_egl_proc(&egl->procs.eglBindWaylandDisplayWL,
@@ -0,0 +1,307 @@
+#include <assert.h>
+#include <GLES2/gl2.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wayland-util.h>
+#include <wlr/types/wlr_box.h>
+#include <wlr/types/wlr_matrix.h>
+#include <wlr/util/log.h>
+#include "render/gles2.h"
+
+static const float flip_180[9] = {
+	1.0f, 0.0f, 0.0f,
+	0.0f, -1.0f, 0.0f,
+	0.0f, 0.0f, 1.0f,
+};
+
+static const GLfloat identity[9] = {
+	1.0f, 0.0f, 0.0f,
+	0.0f, 1.0f, 0.0f,
+	0.0f, 0.0f, 1.0f,
+};
+
+// Unit square corners of the two triangles making up a quad
+static const float quad_corners[6][2] = {
+	{0, 0}, {1, 0}, {0, 1},
+	{1, 0}, {1, 1}, {0, 1},
+};
+
+static void transform_point(const float mat[static 9], float u, float v,
+		float *x, float *y) {
+	*x = mat[0] * u + mat[1] * v + mat[2];
+	*y = mat[3] * u + mat[4] * v + mat[5];
+}
+
+/**
+ * Restrict the [*t0, *t1] range of unit square coordinates so that
+ * `scale * t + offset` stays within [c1, c2]. Returns false if the resulting
+ * range is empty.
+ */
+static bool clip_range(float scale, float offset, int c1, int c2,
+		float *t0, float *t1) {
+	if (scale == 0) {
+		return false;
+	}
+	float a = (c1 - offset) / scale;
+	float b = (c2 - offset) / scale;
+	*t0 = fmaxf(*t0, fminf(a, b));
+	*t1 = fminf(*t1, fmaxf(a, b));
+	return *t0 < *t1;
+}
+
+static bool box_equal(const struct wlr_box *a, const struct wlr_box *b) {
+	return a->x == b->x && a->y == b->y &&
+		a->width == b->width && a->height == b->height;
+}
+
+static void box_union(struct wlr_box *dst, const struct wlr_box *a,
+		const struct wlr_box *b) {
+	int x1 = a->x < b->x ? a->x : b->x;
+	int y1 = a->y < b->y ? a->y : b->y;
+	int x2 = a->x + a->width > b->x + b->width ?
+		a->x + a->width : b->x + b->width;
+	int y2 = a->y + a->height > b->y + b->height ?
+		a->y + a->height : b->y + b->height;
+	*dst = (struct wlr_box){ .x = x1, .y = y1,
+		.width = x2 - x1, .height = y2 - y1 };
+}
+
+static bool draw_matches(const struct wlr_gles2_batch_draw *draw,
+		struct wlr_gles2_texture *texture, float alpha,
+		const struct wlr_box *clip) {
+	if (draw->texture != texture || draw->alpha != alpha) {
+		return false;
+	}
+	if (clip == NULL) {
+		return !draw->has_clip;
+	}
+	return draw->has_clip && box_equal(&draw->clip, clip);
+}
+
+bool gles2_batch_add(struct wlr_gles2_renderer *renderer,
+		struct wlr_gles2_texture *texture, const struct wlr_fbox *box,
+		const float matrix[static 9], float alpha,
+		const struct wlr_box *clip) {
+	if (gles2_get_tex_shader(renderer, texture) == NULL) {
+		return false;
+	}
+
+	// Axis-aligned quads are clipped by adjusting their vertices, so that
+	// they can share draw calls regardless of the clip box. Others are
+	// clipped with the scissor box.
+	float u0 = 0, v0 = 0, u1 = 1, v1 = 1;
+	if (clip != NULL && matrix[1] == 0 && matrix[3] == 0) {
+		if (!clip_range(matrix[0], matrix[2], clip->x, clip->x + clip->width,
+				&u0, &u1) ||
+				!clip_range(matrix[4], matrix[5], clip->y,
+				clip->y + clip->height, &v0, &v1)) {
+			return true;
+		}
+		clip = NULL;
+	}
+
+	float x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+	for (size_t i = 0; i < 6; i++) {
+		float x, y;
+		transform_point(matrix, quad_corners[i][0] ? u1 : u0,
+			quad_corners[i][1] ? v1 : v0, &x, &y);
+		x1 = fminf(x1, x);
+		y1 = fminf(y1, y);
+		x2 = fmaxf(x2, x);
+		y2 = fmaxf(y2, y);
+	}
+	struct wlr_box bounds = {
+		.x = floorf(x1),
+		.y = floorf(y1),
+		.width = ceilf(x2) - floorf(x1),
+		.height = ceilf(y2) - floorf(y1),
+	};
+	if (clip != NULL && !wlr_box_intersection(&bounds, &bounds, clip)) {
+		return true;
+	}
+
+	// Join the last draw call with the same parameters, unless the quad
+	// overlaps with a draw call submitted after it
+	struct wlr_gles2_batch_draw *draws = renderer->batch.draws.data;
+	size_t draws_len = renderer->batch.draws.size / sizeof(*draws);
+	size_t draw_idx = draws_len;
+	for (size_t i = draws_len; i-- > 0;) {
+		struct wlr_box intersection;
+		if (draw_matches(&draws[i], texture, alpha, clip)) {
+			draw_idx = i;
+			break;
+		} else if (wlr_box_intersection(&intersection, &draws[i].bounds,
+				&bounds)) {
+			break;
+		}
+	}
+
+	if (draw_idx == draws_len) {
+		struct wlr_gles2_batch_draw *draw =
+			wl_array_add(&renderer->batch.draws, sizeof(*draw));
+		if (draw == NULL) {
+			wlr_log_errno(WLR_ERROR, "Allocation failed");
+			return false;
+		}
+		*draw = (struct wlr_gles2_batch_draw){
+			.texture = texture,
+			.alpha = alpha,
+			.has_clip = clip != NULL,
+			.bounds = bounds,
+		};
+		if (clip != NULL) {
+			draw->clip = *clip;
+		}
+	} else {
+		box_union(&draws[draw_idx].bounds, &draws[draw_idx].bounds, &bounds);
+	}
+
+	struct wlr_gles2_batch_quad *quad =
+		wl_array_add(&renderer->batch.quads, sizeof(*quad));
+	if (quad == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+	draws = renderer->batch.draws.data;
+	draws[draw_idx].quads_len++;
+	quad->draw = draw_idx;
+
+	float gl_matrix[9];
+	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
+	wlr_matrix_multiply(gl_matrix, flip_180, gl_matrix);
+
+	const struct wlr_texture *wlr_texture = &texture->wlr_texture;
+	for (size_t i = 0; i < 6; i++) {
+		float u = quad_corners[i][0] ? u1 : u0;
+		float v = quad_corners[i][1] ? v1 : v0;
+		GLfloat *vertex = quad->vertices[i];
+		transform_point(gl_matrix, u, v, &vertex[0], &vertex[1]);
+		vertex[2] = (box->x + u * box->width) / wlr_texture->width;
+		vertex[3] = (box->y + v * box->height) / wlr_texture->height;
+	}
+
+	return true;
+}
+
+static void draw_batch(struct wlr_gles2_renderer *renderer,
+		struct wlr_gles2_batch_draw *draw) {
+	struct wlr_renderer *wlr_renderer = &renderer->wlr_renderer;
+	struct wlr_gles2_texture *texture = draw->texture;
+	struct wlr_gles2_tex_shader *shader =
+		gles2_get_tex_shader(renderer, texture);
+	assert(shader != NULL);
+
+	if (draw->has_clip) {
+		struct wlr_box scissor_box = draw->clip;
+		if (wlr_renderer->has_scissor && !wlr_box_intersection(&scissor_box,
+				&scissor_box, &wlr_renderer->scissor_box)) {
+			return;
+		}
+		glScissor(scissor_box.x, scissor_box.y,
+			scissor_box.width, scissor_box.height);
+		glEnable(GL_SCISSOR_TEST);
+	}
+
+	glBindTexture(texture->target, texture->tex);
+	glTexParameteri(texture->target, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+	glUseProgram(shader->program);
+
+	// Vertices are already in clip space
+	glUniformMatrix3fv(shader->proj, 1, GL_FALSE, identity);
+	glUniform1i(shader->invert_y, texture->inverted_y);
+	glUniform1i(shader->tex, 0);
+	glUniform1f(shader->alpha, draw->alpha);
+
+	GLsizei stride = 4 * sizeof(GLfloat);
+	glVertexAttribPointer(shader->pos_attrib, 2, GL_FLOAT, GL_FALSE,
+		stride, (const void *)0);
+	glVertexAttribPointer(shader->tex_attrib, 2, GL_FLOAT, GL_FALSE,
+		stride, (const void *)(2 * sizeof(GLfloat)));
+
+	glEnableVertexAttribArray(shader->pos_attrib);
+	glEnableVertexAttribArray(shader->tex_attrib);
+
+	glDrawArrays(GL_TRIANGLES, draw->first_vertex, draw->vertices_len);
+
+	glDisableVertexAttribArray(shader->pos_attrib);
+	glDisableVertexAttribArray(shader->tex_attrib);
+
+	glBindTexture(texture->target, 0);
+
+	if (draw->has_clip) {
+		const struct wlr_box *box = &wlr_renderer->scissor_box;
+		if (wlr_renderer->has_scissor) {
+			glScissor(box->x, box->y, box->width, box->height);
+		} else {
+			glDisable(GL_SCISSOR_TEST);
+		}
+	}
+}
+
+void gles2_batch_flush(struct wlr_gles2_renderer *renderer) {
+	struct wlr_gles2_batch_draw *draws = renderer->batch.draws.data;
+	size_t draws_len = renderer->batch.draws.size / sizeof(*draws);
+	if (renderer->batch.quads.size == 0) {
+		goto out;
+	}
+
+	// Lay out the quads of each draw call contiguously
+	size_t vertices_len = 0;
+	for (size_t i = 0; i < draws_len; i++) {
+		draws[i].first_vertex = vertices_len;
+		draws[i].vertices_len = 0;
+		vertices_len += 6 * draws[i].quads_len;
+	}
+
+	renderer->batch.vertices.size = 0;
+	GLfloat *vertices = wl_array_add(&renderer->batch.vertices,
+		vertices_len * 4 * sizeof(GLfloat));
+	if (vertices == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		goto out;
+	}
+
+	struct wlr_gles2_batch_quad *quad;
+	wl_array_for_each(quad, &renderer->batch.quads) {
+		struct wlr_gles2_batch_draw *draw = &draws[quad->draw];
+		memcpy(&vertices[4 * (draw->first_vertex + draw->vertices_len)],
+			quad->vertices, sizeof(quad->vertices));
+		draw->vertices_len += 6;
+	}
+
+	push_gles2_debug(renderer);
+
+	if (renderer->batch.vbo == 0) {
+		glGenBuffers(1, &renderer->batch.vbo);
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, renderer->batch.vbo);
+	glBufferData(GL_ARRAY_BUFFER, renderer->batch.vertices.size, vertices,
+		GL_STREAM_DRAW);
+
+	glActiveTexture(GL_TEXTURE0);
+
+	for (size_t i = 0; i < draws_len; i++) {
+		if (draws[i].vertices_len > 0) {
+			draw_batch(renderer, &draws[i]);
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	pop_gles2_debug(renderer);
+
+out:
+	renderer->batch.draws.size = 0;
+	renderer->batch.quads.size = 0;
+}
+
+void gles2_batch_finish(struct wlr_gles2_renderer *renderer) {
+	if (renderer->batch.vbo != 0) {
+		glDeleteBuffers(1, &renderer->batch.vbo);
+	}
+	wl_array_release(&renderer->batch.draws);
+	wl_array_release(&renderer->batch.quads);
+	wl_array_release(&renderer->batch.vertices);
+}
@@ -0,0 +1,259 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "render/gles2.h"
+
+#define PROGRAM_CACHE_MAGIC "wlrprog"
+#define PROGRAM_CACHE_VERSION 1
+// Program binaries are typically a few KiB, reject anything unreasonable
+#define PROGRAM_CACHE_MAX_BINARY_LEN (16 * 1024 * 1024)
+
+struct program_cache_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t binary_format;
+	uint64_t key;
+	uint32_t binary_len;
+};
+
+static uint64_t hash_str(uint64_t hash, const char *str) {
+	// FNV-1a, including the NUL terminator to separate strings
+	do {
+		hash ^= (unsigned char)*str;
+		hash *= 0x100000001b3;
+	} while (*str++ != '\0');
+	return hash;
+}
+
+static const char *get_gl_string(GLenum name) {
+	const char *str = (const char *)glGetString(name);
+	return str != NULL ? str : "";
+}
+
+static uint64_t get_program_key(const GLchar *vert_src,
+		const GLchar *frag_src) {
+	// Binaries are only valid for the driver which produced them
+	uint64_t hash = 0xcbf29ce484222325;
+	hash = hash_str(hash, get_gl_string(GL_VENDOR));
+	hash = hash_str(hash, get_gl_string(GL_RENDERER));
+	hash = hash_str(hash, get_gl_string(GL_VERSION));
+	hash = hash_str(hash, vert_src);
+	hash = hash_str(hash, frag_src);
+	return hash;
+}
+
+static char *get_program_path(const char *dir, uint64_t key) {
+	int len = snprintf(NULL, 0, "%s/%016" PRIx64 ".bin", dir, key) + 1;
+	char *path = malloc(len);
+	if (path == NULL) {
+		return NULL;
+	}
+	snprintf(path, len, "%s/%016" PRIx64 ".bin", dir, key);
+	return path;
+}
+
+static bool mkdir_parents(char *path) {
+	for (char *p = path + 1; ; p++) {
+		if (*p != '/' && *p != '\0') {
+			continue;
+		}
+		char c = *p;
+		*p = '\0';
+		int ret = mkdir(path, 0700);
+		*p = c;
+		if (ret != 0 && errno != EEXIST) {
+			wlr_log_errno(WLR_DEBUG, "Failed to create directory %s", path);
+			return false;
+		}
+		if (c == '\0') {
+			return true;
+		}
+	}
+}
+
+char *gles2_get_program_cache_dir(void) {
+	const char *disable = getenv("WLR_GLES2_NO_PROGRAM_CACHE");
+	if (disable != NULL && strcmp(disable, "1") == 0) {
+		return NULL;
+	}
+
+	const char *base = getenv("XDG_CACHE_HOME");
+	const char *suffix = "/wlroots/gles2-programs";
+	if (base == NULL || base[0] != '/') {
+		base = getenv("HOME");
+		suffix = "/.cache/wlroots/gles2-programs";
+	}
+	if (base == NULL || base[0] != '/') {
+		return NULL;
+	}
+
+	size_t len = strlen(base) + strlen(suffix) + 1;
+	char *dir = malloc(len);
+	if (dir == NULL) {
+		return NULL;
+	}
+	snprintf(dir, len, "%s%s", base, suffix);
+	return dir;
+}
+
+GLuint gles2_program_cache_load(struct wlr_gles2_renderer *renderer,
+		const GLchar *vert_src, const GLchar *frag_src) {
+	if (renderer->program_cache_dir == NULL ||
+			!renderer->exts.get_program_binary_oes) {
+		return 0;
+	}
+
+	uint64_t key = get_program_key(vert_src, frag_src);
+	char *path = get_program_path(renderer->program_cache_dir, key);
+	if (path == NULL) {
+		return 0;
+	}
+
+	GLuint prog = 0;
+	void *binary = NULL;
+	FILE *f = fopen(path, "rb");
+	if (f == NULL) {
+		goto out;
+	}
+
+	struct program_cache_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 ||
+			memcmp(header.magic, PROGRAM_CACHE_MAGIC,
+				sizeof(PROGRAM_CACHE_MAGIC)) != 0 ||
+			header.version != PROGRAM_CACHE_VERSION ||
+			header.key != key || header.binary_len == 0 ||
+			header.binary_len > PROGRAM_CACHE_MAX_BINARY_LEN) {
+		wlr_log(WLR_DEBUG, "Ignoring invalid program cache entry %s", path);
+		goto out_unlink;
+	}
+
+	binary = malloc(header.binary_len);
+	if (binary == NULL) {
+		goto out;
+	}
+	if (fread(binary, header.binary_len, 1, f) != 1) {
+		wlr_log(WLR_DEBUG, "Ignoring truncated program cache entry %s", path);
+		goto out_unlink;
+	}
+
+	push_gles2_debug(renderer);
+
+	prog = glCreateProgram();
+	renderer->procs.glProgramBinaryOES(prog, header.binary_format, binary,
+		header.binary_len);
+
+	GLint ok;
+	glGetProgramiv(prog, GL_LINK_STATUS, &ok);
+	if (ok == GL_FALSE) {
+		glDeleteProgram(prog);
+		prog = 0;
+	}
+
+	pop_gles2_debug(renderer);
+
+	if (prog == 0) {
+		// The driver changed without changing its version string
+		wlr_log(WLR_DEBUG, "Driver rejected program cache entry %s", path);
+		goto out_unlink;
+	}
+
+	goto out;
+
+out_unlink:
+	unlink(path);
+out:
+	if (f != NULL) {
+		fclose(f);
+	}
+	free(binary);
+	free(path);
+	return prog;
+}
+
+void gles2_program_cache_store(struct wlr_gles2_renderer *renderer,
+		GLuint prog, const GLchar *vert_src, const GLchar *frag_src) {
+	if (renderer->program_cache_dir == NULL ||
+			!renderer->exts.get_program_binary_oes) {
+		return;
+	}
+
+	push_gles2_debug(renderer);
+
+	GLint len = 0;
+	glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH_OES, &len);
+	void *binary = NULL;
+	GLsizei binary_len = 0;
+	GLenum binary_format = 0;
+	if (len > 0 && len <= PROGRAM_CACHE_MAX_BINARY_LEN) {
+		binary = malloc(len);
+	}
+	if (binary != NULL) {
+		renderer->procs.glGetProgramBinaryOES(prog, len, &binary_len,
+			&binary_format, binary);
+	}
+
+	pop_gles2_debug(renderer);
+
+	if (binary == NULL || binary_len <= 0) {
+		free(binary);
+		return;
+	}
+
+	uint64_t key = get_program_key(vert_src, frag_src);
+	char *path = get_program_path(renderer->program_cache_dir, key);
+	char *tmp_path = NULL;
+	if (path == NULL || !mkdir_parents(renderer->program_cache_dir)) {
+		goto out;
+	}
+
+	// Write to a temporary file first, so that concurrent compositors never
+	// see a partially written entry
+	size_t tmp_path_len = strlen(path) + 8;
+	tmp_path = malloc(tmp_path_len);
+	if (tmp_path == NULL) {
+		goto out;
+	}
+	snprintf(tmp_path, tmp_path_len, "%s.XXXXXX", path);
+	int fd = mkstemp(tmp_path);
+	if (fd < 0) {
+		wlr_log_errno(WLR_DEBUG, "Failed to create %s", tmp_path);
+		goto out;
+	}
+	FILE *f = fdopen(fd, "wb");
+	if (f == NULL) {
+		close(fd);
+		unlink(tmp_path);
+		goto out;
+	}
+
+	struct program_cache_header header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(PROGRAM_CACHE_MAGIC));
+	header.version = PROGRAM_CACHE_VERSION;
+	header.binary_format = binary_format;
+	header.key = key;
+	header.binary_len = binary_len;
+
+	bool ok = fwrite(&header, sizeof(header), 1, f) == 1 &&
+		fwrite(binary, binary_len, 1, f) == 1;
+	ok = fclose(f) == 0 && ok;
+	if (!ok || rename(tmp_path, path) != 0) {
+		wlr_log_errno(WLR_DEBUG, "Failed to write program cache entry %s",
+			path);
+		unlink(tmp_path);
+	}
+
+out:
+	free(tmp_path);
+	free(path);
+	free(binary);
+}
@@ -0,0 +1,246 @@
+#include <assert.h>
+#include <GLES2/gl2.h>
+#include <GLES2/gl2ext.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/render/egl.h>
+#include <wlr/render/interface.h>
+#include <wlr/util/log.h>
+#include "render/gles2.h"
+#include "render/pixel_format.h"
+
+// From GLES 3.0, GLES 2.0 only has draw usage hints
+#define GL_STREAM_READ 0x88E1
+
+static const struct wlr_render_readback_impl readback_impl;
+
+static struct wlr_gles2_readback *gles2_get_readback(
+		struct wlr_render_readback *wlr_readback) {
+	assert(wlr_readback->impl == &readback_impl);
+	return (struct wlr_gles2_readback *)wlr_readback;
+}
+
+static int gles2_readback_get_fd(struct wlr_render_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	return readback->fence_fd;
+}
+
+static bool gles2_readback_is_done(struct wlr_render_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	if (readback->renderer == NULL) {
+		// Let the caller find out through wlr_render_readback_copy
+		return true;
+	}
+	struct wlr_egl *egl = readback->renderer->egl;
+	EGLint ret = egl->procs.eglClientWaitSyncKHR(egl->display,
+		readback->fence, 0, 0);
+	return ret == EGL_CONDITION_SATISFIED_KHR;
+}
+
+static bool gles2_readback_copy(struct wlr_render_readback *wlr_readback,
+		uint32_t *flags, uint32_t stride, void *data) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+	struct wlr_gles2_renderer *renderer = readback->renderer;
+	if (renderer == NULL) {
+		wlr_log(WLR_ERROR, "Cannot copy pixels: renderer destroyed");
+		return false;
+	}
+	struct wlr_egl *egl = renderer->egl;
+
+	if (stride < readback->pack_stride) {
+		wlr_log(WLR_ERROR, "Cannot copy pixels: stride too small");
+		return false;
+	}
+
+	EGLint ret = egl->procs.eglClientWaitSyncKHR(egl->display,
+		readback->fence, 0, EGL_FOREVER_KHR);
+	if (ret != EGL_CONDITION_SATISFIED_KHR) {
+		wlr_log(WLR_ERROR, "eglClientWaitSyncKHR failed");
+		return false;
+	}
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(egl);
+
+	push_gles2_debug(renderer);
+
+	size_t size = (size_t)readback->pack_stride * wlr_readback->height;
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, readback->pbo);
+	const unsigned char *src = renderer->procs.glMapBufferRangeEXT(
+		GL_PIXEL_PACK_BUFFER_NV, 0, size, GL_MAP_READ_BIT_EXT);
+	if (src != NULL) {
+		unsigned char *dst = data;
+		for (size_t i = 0; i < wlr_readback->height; ++i) {
+			memcpy(dst + i * stride, src + i * readback->pack_stride,
+				readback->pack_stride);
+		}
+		renderer->procs.glUnmapBufferOES(GL_PIXEL_PACK_BUFFER_NV);
+	} else {
+		wlr_log(WLR_ERROR, "Failed to map pixel buffer object");
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0);
+
+	pop_gles2_debug(renderer);
+
+	wlr_egl_restore_context(&prev_ctx);
+
+	if (flags != NULL) {
+		*flags = 0;
+	}
+
+	return src != NULL;
+}
+
+void gles2_readback_release(struct wlr_gles2_readback *readback) {
+	struct wlr_gles2_renderer *renderer = readback->renderer;
+
+	push_gles2_debug(renderer);
+	glDeleteBuffers(1, &readback->pbo);
+	pop_gles2_debug(renderer);
+
+	if (readback->fence != EGL_NO_SYNC_KHR) {
+		renderer->egl->procs.eglDestroySyncKHR(renderer->egl->display,
+			readback->fence);
+		readback->fence = EGL_NO_SYNC_KHR;
+	}
+
+	readback->pbo = 0;
+	readback->renderer = NULL;
+	wl_list_remove(&readback->link);
+	wl_list_init(&readback->link);
+}
+
+static void gles2_readback_destroy(struct wlr_render_readback *wlr_readback) {
+	struct wlr_gles2_readback *readback = gles2_get_readback(wlr_readback);
+
+	if (readback->renderer != NULL) {
+		struct wlr_egl_context prev_ctx;
+		wlr_egl_save_context(&prev_ctx);
+		wlr_egl_make_current(readback->renderer->egl);
+		gles2_readback_release(readback);
+		wlr_egl_restore_context(&prev_ctx);
+	}
+
+	// The file descriptor may still be watched by the caller until the
+	// readback is destroyed, keep it open until then
+	if (readback->fence_fd >= 0) {
+		close(readback->fence_fd);
+	}
+	free(readback);
+}
+
+static const struct wlr_render_readback_impl readback_impl = {
+	.get_fd = gles2_readback_get_fd,
+	.is_done = gles2_readback_is_done,
+	.copy = gles2_readback_copy,
+	.destroy = gles2_readback_destroy,
+};
+
+static bool create_fence(struct wlr_gles2_readback *readback) {
+	struct wlr_egl *egl = readback->renderer->egl;
+
+	if (egl->exts.native_fence_sync_android) {
+		const EGLint attribs[] = {
+			EGL_SYNC_NATIVE_FENCE_FD_ANDROID, EGL_NO_NATIVE_FENCE_FD_ANDROID,
+			EGL_NONE,
+		};
+		readback->fence = egl->procs.eglCreateSyncKHR(egl->display,
+			EGL_SYNC_NATIVE_FENCE_ANDROID, attribs);
+		if (readback->fence != EGL_NO_SYNC_KHR) {
+			// The native fence is only created once commands are flushed
+			glFlush();
+			readback->fence_fd = egl->procs.eglDupNativeFenceFDANDROID(
+				egl->display, readback->fence);
+			if (readback->fence_fd == EGL_NO_NATIVE_FENCE_FD_ANDROID) {
+				wlr_log(WLR_DEBUG, "eglDupNativeFenceFDANDROID failed");
+				readback->fence_fd = -1;
+			}
+			return true;
+		}
+		wlr_log(WLR_DEBUG, "Failed to create native fence, "
+			"falling back to EGL_KHR_fence_sync");
+	}
+
+	readback->fence = egl->procs.eglCreateSyncKHR(egl->display,
+		EGL_SYNC_FENCE_KHR, NULL);
+	if (readback->fence == EGL_NO_SYNC_KHR) {
+		wlr_log(WLR_ERROR, "eglCreateSyncKHR failed");
+		return false;
+	}
+	// Make sure the GPU starts working on the read
+	glFlush();
+	return true;
+}
+
+struct wlr_render_readback *gles2_read_pixels_async(
+		struct wlr_gles2_renderer *renderer, uint32_t drm_format,
+		uint32_t width, uint32_t height, uint32_t src_x, uint32_t src_y) {
+	if (!renderer->exts.pixel_buffer_object || !renderer->exts.mapbuffer_oes) {
+		return NULL;
+	}
+
+	const struct wlr_gles2_pixel_format *fmt =
+		get_gles2_format_from_drm(drm_format);
+	if (fmt == NULL) {
+		wlr_log(WLR_ERROR, "Cannot read pixels: unsupported pixel format");
+		return NULL;
+	}
+
+	if (fmt->gl_format == GL_BGRA_EXT && !renderer->exts.read_format_bgra_ext) {
+		wlr_log(WLR_ERROR,
+			"Cannot read pixels: missing GL_EXT_read_format_bgra extension");
+		return NULL;
+	}
+
+	const struct wlr_pixel_format_info *drm_fmt =
+		drm_get_pixel_format_info(fmt->drm_format);
+	assert(drm_fmt);
+
+	struct wlr_gles2_readback *readback = calloc(1, sizeof(*readback));
+	if (readback == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_render_readback_init(&readback->base, &readback_impl, drm_format,
+		width, height);
+	readback->renderer = renderer;
+	readback->fmt = fmt;
+	readback->pack_stride = width * drm_fmt->bpp / 8;
+	readback->fence = EGL_NO_SYNC_KHR;
+	readback->fence_fd = -1;
+	wl_list_insert(&renderer->readbacks, &readback->link);
+
+	push_gles2_debug(renderer);
+
+	glGetError(); // Clear the error flag
+
+	glGenBuffers(1, &readback->pbo);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, readback->pbo);
+	GLenum usage = renderer->gl_major_version >= 3 ?
+		GL_STREAM_READ : GL_STREAM_DRAW;
+	glBufferData(GL_PIXEL_PACK_BUFFER_NV,
+		(GLsizeiptr)readback->pack_stride * height, NULL, usage);
+
+	// Rows are tightly packed in the buffer object, the read only blocks
+	// until the GPU is done once the buffer is mapped
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(src_x, src_y, width, height, fmt->gl_format, fmt->gl_type,
+		NULL);
+	glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER_NV, 0);
+
+	bool ok = glGetError() == GL_NO_ERROR && create_fence(readback);
+
+	pop_gles2_debug(renderer);
+
+	if (!ok) {
+		wlr_log(WLR_ERROR, "Failed to start asynchronous pixel read");
+		gles2_readback_destroy(&readback->base);
+		return NULL;
+	}
+
+	return &readback->base;
+}
@@ -16,6 +16,7 @@
 #include <wlr/util/log.h>
 #include "render/gles2.h"
 #include "render/pixel_format.h"
+#include "types/wlr_buffer.h"
 
 static const GLfloat verts[] = {
 	1, 0, // top right
@@ -200,6 +201,10 @@ static void gles2_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
 
+	// wlr_renderer_begin resets the tracked scissor box, don't let one left
+	// enabled by the previous frame clip this one
+	glDisable(GL_SCISSOR_TEST);
+
 	// XXX: maybe we should save output projection and remove some of the need
 	// for users to sling matricies themselves
 
@@ -216,6 +221,8 @@ static void gles2_clear(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_batch_flush(renderer);
+
 	push_gles2_debug(renderer);
 	glClearColor(color[0], color[1], color[2], color[3]);
 	glClear(GL_COLOR_BUFFER_BIT);
@@ -227,6 +234,8 @@ static void gles2_scissor(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_batch_flush(renderer);
+
 	push_gles2_debug(renderer);
 	if (box != NULL) {
 		glScissor(box->x, box->y, box->width, box->height);
@@ -243,37 +252,44 @@ static const float flip_180[9] = {
 	0.0f, 0.0f, 1.0f,
 };
 
-static bool gles2_render_subtexture_with_matrix(
-		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
-		const struct wlr_fbox *box, const float matrix[static 9],
-		float alpha) {
-	struct wlr_gles2_renderer *renderer =
-		gles2_get_renderer_in_context(wlr_renderer);
-	struct wlr_gles2_texture *texture =
-		gles2_get_texture(wlr_texture);
-
-	struct wlr_gles2_tex_shader *shader = NULL;
-
+struct wlr_gles2_tex_shader *gles2_get_tex_shader(
+		struct wlr_gles2_renderer *renderer,
+		struct wlr_gles2_texture *texture) {
 	switch (texture->target) {
 	case GL_TEXTURE_2D:
 		if (texture->has_alpha) {
-			shader = &renderer->shaders.tex_rgba;
+			return &renderer->shaders.tex_rgba;
 		} else {
-			shader = &renderer->shaders.tex_rgbx;
+			return &renderer->shaders.tex_rgbx;
 		}
-		break;
 	case GL_TEXTURE_EXTERNAL_OES:
-		shader = &renderer->shaders.tex_ext;
-
 		if (!renderer->exts.egl_image_external_oes) {
 			wlr_log(WLR_ERROR, "Failed to render texture: "
 				"GL_TEXTURE_EXTERNAL_OES not supported");
-			return false;
+			return NULL;
 		}
-		break;
+		return &renderer->shaders.tex_ext;
 	default:
 		abort();
 	}
+}
+
+static bool gles2_render_subtexture_with_matrix(
+		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
+		const struct wlr_fbox *box, const float matrix[static 9],
+		float alpha) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+	struct wlr_gles2_texture *texture =
+		gles2_get_texture(wlr_texture);
+
+	gles2_batch_flush(renderer);
+
+	struct wlr_gles2_tex_shader *shader =
+		gles2_get_tex_shader(renderer, texture);
+	if (shader == NULL) {
+		return false;
+	}
 
 	float gl_matrix[9];
 	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
@@ -330,6 +346,8 @@ static void gles2_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_batch_flush(renderer);
+
 	float gl_matrix[9];
 	wlr_matrix_multiply(gl_matrix, renderer->projection, matrix);
 	wlr_matrix_multiply(gl_matrix, flip_180, gl_matrix);
@@ -356,6 +374,21 @@ static void gles2_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
 	pop_gles2_debug(renderer);
 }
 
+static bool gles2_batch_add_(struct wlr_renderer *wlr_renderer,
+		struct wlr_texture *wlr_texture, const struct wlr_fbox *box,
+		const float matrix[static 9], float alpha, const struct wlr_box *clip) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+	struct wlr_gles2_texture *texture = gles2_get_texture(wlr_texture);
+	return gles2_batch_add(renderer, texture, box, matrix, alpha, clip);
+}
+
+static void gles2_batch_flush_(struct wlr_renderer *wlr_renderer) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+	gles2_batch_flush(renderer);
+}
+
 static const uint32_t *gles2_get_shm_texture_formats(
 		struct wlr_renderer *wlr_renderer, size_t *len) {
 	return get_gles2_shm_formats(len);
@@ -395,12 +428,17 @@ static const struct wlr_drm_format_set *gles2_get_dmabuf_texture_formats(
 	return wlr_egl_get_dmabuf_texture_formats(renderer->egl);
 }
 
-static const struct wlr_drm_format_set *gles2_get_dmabuf_render_formats(
+static const struct wlr_drm_format_set *gles2_get_render_formats(
 		struct wlr_renderer *wlr_renderer) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
 	return wlr_egl_get_dmabuf_render_formats(renderer->egl);
 }
 
+static uint32_t gles2_get_render_buffer_caps(
+		struct wlr_renderer *wlr_renderer) {
+	return WLR_BUFFER_CAP_DMABUF;
+}
+
 static uint32_t gles2_preferred_read_format(
 		struct wlr_renderer *wlr_renderer) {
 	struct wlr_gles2_renderer *renderer =
@@ -439,6 +477,8 @@ static bool gles2_read_pixels(struct wlr_renderer *wlr_renderer,
 	struct wlr_gles2_renderer *renderer =
 		gles2_get_renderer_in_context(wlr_renderer);
 
+	gles2_batch_flush(renderer);
+
 	const struct wlr_gles2_pixel_format *fmt =
 		get_gles2_format_from_drm(drm_format);
 	if (fmt == NULL) {
@@ -489,6 +529,18 @@ static bool gles2_read_pixels(struct wlr_renderer *wlr_renderer,
 	return glGetError() == GL_NO_ERROR;
 }
 
+static struct wlr_render_readback *gles2_read_pixels_async_(
+		struct wlr_renderer *wlr_renderer, uint32_t drm_format,
+		uint32_t width, uint32_t height, uint32_t src_x, uint32_t src_y) {
+	struct wlr_gles2_renderer *renderer =
+		gles2_get_renderer_in_context(wlr_renderer);
+
+	gles2_batch_flush(renderer);
+
+	return gles2_read_pixels_async(renderer, drm_format, width, height,
+		src_x, src_y);
+}
+
 static bool gles2_init_wl_display(struct wlr_renderer *wlr_renderer,
 		struct wl_display *wl_display) {
 	struct wlr_gles2_renderer *renderer =
@@ -531,6 +583,88 @@ struct wlr_egl *wlr_gles2_renderer_get_egl(struct wlr_renderer *wlr_renderer) {
 	return renderer->egl;
 }
 
+static void destroy_upload_buffer(struct wlr_gles2_renderer *renderer,
+		struct wlr_gles2_upload_buffer *buffer) {
+	if (buffer->fence != EGL_NO_SYNC_KHR) {
+		renderer->egl->procs.eglDestroySyncKHR(renderer->egl->display,
+			buffer->fence);
+	}
+	// Deleting the buffer implicitly unmaps it
+	glDeleteBuffers(1, &buffer->pbo);
+	*buffer = (struct wlr_gles2_upload_buffer){ .fence = EGL_NO_SYNC_KHR };
+}
+
+struct wlr_gles2_upload_buffer *gles2_get_upload_buffer(
+		struct wlr_gles2_renderer *renderer, size_t size) {
+	if (!renderer->exts.pixel_buffer_object ||
+			!renderer->exts.buffer_storage_ext) {
+		return NULL;
+	}
+
+	struct wlr_gles2_upload_buffer *buffer =
+		&renderer->upload_buffers[renderer->upload_buffer_idx];
+
+	if (buffer->fence != EGL_NO_SYNC_KHR) {
+		// Don't stall waiting for the GPU: let the caller fall back to a
+		// direct upload if the previous copy is still in flight
+		EGLint ret = renderer->egl->procs.eglClientWaitSyncKHR(
+			renderer->egl->display, buffer->fence,
+			EGL_SYNC_FLUSH_COMMANDS_BIT_KHR, 0);
+		if (ret != EGL_CONDITION_SATISFIED_KHR) {
+			if (ret == EGL_FALSE) {
+				wlr_log(WLR_ERROR, "eglClientWaitSyncKHR failed");
+			}
+			return NULL;
+		}
+		renderer->egl->procs.eglDestroySyncKHR(renderer->egl->display,
+			buffer->fence);
+		buffer->fence = EGL_NO_SYNC_KHR;
+	}
+
+	if (buffer->size < size) {
+		push_gles2_debug(renderer);
+
+		if (buffer->pbo != 0) {
+			destroy_upload_buffer(renderer, buffer);
+		}
+
+		GLbitfield flags = GL_MAP_WRITE_BIT_EXT | GL_MAP_PERSISTENT_BIT_EXT |
+			GL_MAP_COHERENT_BIT_EXT;
+		glGenBuffers(1, &buffer->pbo);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER_NV, buffer->pbo);
+		renderer->procs.glBufferStorageEXT(GL_PIXEL_UNPACK_BUFFER_NV, size,
+			NULL, flags);
+		buffer->data = renderer->procs.glMapBufferRangeEXT(
+			GL_PIXEL_UNPACK_BUFFER_NV, 0, size, flags);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER_NV, 0);
+
+		pop_gles2_debug(renderer);
+
+		if (buffer->data == NULL) {
+			wlr_log(WLR_ERROR, "Failed to map pixel buffer object");
+			destroy_upload_buffer(renderer, buffer);
+			return NULL;
+		}
+		buffer->size = size;
+	}
+
+	renderer->upload_buffer_idx =
+		(renderer->upload_buffer_idx + 1) % WLR_GLES2_UPLOAD_RING_LEN;
+	return buffer;
+}
+
+void gles2_upload_buffer_fence(struct wlr_gles2_renderer *renderer,
+		struct wlr_gles2_upload_buffer *buffer) {
+	assert(buffer->fence == EGL_NO_SYNC_KHR);
+	buffer->fence = renderer->egl->procs.eglCreateSyncKHR(
+		renderer->egl->display, EGL_SYNC_FENCE_KHR, NULL);
+	if (buffer->fence == EGL_NO_SYNC_KHR) {
+		// Without a fence we can't tell when the GPU is done reading
+		wlr_log(WLR_ERROR, "eglCreateSyncKHR failed, waiting for the GPU");
+		glFinish();
+	}
+}
+
 static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 	struct wlr_gles2_renderer *renderer = gles2_get_renderer(wlr_renderer);
 
@@ -541,6 +675,19 @@ static void gles2_destroy(struct wlr_renderer *wlr_renderer) {
 		destroy_buffer(buffer);
 	}
 
+	struct wlr_gles2_readback *readback, *readback_tmp;
+	wl_list_for_each_safe(readback, readback_tmp, &renderer->readbacks, link) {
+		gles2_readback_release(readback);
+	}
+
+	for (size_t i = 0; i < WLR_GLES2_UPLOAD_RING_LEN; i++) {
+		if (renderer->upload_buffers[i].pbo != 0) {
+			destroy_upload_buffer(renderer, &renderer->upload_buffers[i]);
+		}
+	}
+
+	gles2_batch_finish(renderer);
+
 	push_gles2_debug(renderer);
 	glDeleteProgram(renderer->shaders.quad.program);
 	glDeleteProgram(renderer->shaders.tex_rgba.program);
@@ -572,18 +719,22 @@ static const struct wlr_renderer_impl renderer_impl = {
 	.scissor = gles2_scissor,
 	.render_subtexture_with_matrix = gles2_render_subtexture_with_matrix,
 	.render_quad_with_matrix = gles2_render_quad_with_matrix,
+	.batch_add = gles2_batch_add_,
+	.batch_flush = gles2_batch_flush_,
 	.get_shm_texture_formats = gles2_get_shm_texture_formats,
 	.resource_is_wl_drm_buffer = gles2_resource_is_wl_drm_buffer,
 	.wl_drm_buffer_get_size = gles2_wl_drm_buffer_get_size,
 	.get_dmabuf_texture_formats = gles2_get_dmabuf_texture_formats,
-	.get_dmabuf_render_formats = gles2_get_dmabuf_render_formats,
+	.get_render_formats = gles2_get_render_formats,
 	.preferred_read_format = gles2_preferred_read_format,
 	.read_pixels = gles2_read_pixels,
+	.read_pixels_async = gles2_read_pixels_async_,
 	.texture_from_pixels = gles2_texture_from_pixels,
 	.texture_from_wl_drm = gles2_texture_from_wl_drm,
 	.texture_from_dmabuf = gles2_texture_from_dmabuf,
 	.init_wl_display = gles2_init_wl_display,
 	.get_drm_fd = gles2_get_drm_fd,
+	.get_render_buffer_caps = gles2_get_render_buffer_caps,
 };
 
 void push_gles2_debug_(struct wlr_gles2_renderer *renderer,
@@ -645,6 +796,11 @@ static GLuint compile_shader(struct wlr_gles2_renderer *renderer,
 
 static GLuint link_program(struct wlr_gles2_renderer *renderer,
 		const GLchar *vert_src, const GLchar *frag_src) {
+	GLuint cached = gles2_program_cache_load(renderer, vert_src, frag_src);
+	if (cached != 0) {
+		return cached;
+	}
+
 	push_gles2_debug(renderer);
 
 	GLuint vert = compile_shader(renderer, GL_VERTEX_SHADER, vert_src);
@@ -675,6 +831,8 @@ static GLuint link_program(struct wlr_gles2_renderer *renderer,
 		goto error;
 	}
 
+	gles2_program_cache_store(renderer, prog, vert_src, frag_src);
+
 	pop_gles2_debug(renderer);
 	return prog;
 
@@ -736,6 +894,10 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 	wlr_renderer_init(&renderer->wlr_renderer, &renderer_impl);
 
 	wl_list_init(&renderer->buffers);
+	wl_list_init(&renderer->readbacks);
+	wl_array_init(&renderer->batch.draws);
+	wl_array_init(&renderer->batch.quads);
+	wl_array_init(&renderer->batch.vertices);
 
 	renderer->egl = egl;
 	renderer->exts_str = exts_str;
@@ -785,6 +947,45 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 			"glEGLImageTargetRenderbufferStorageOES");
 	}
 
+	// Asynchronous transfers need pixel buffer objects (core in GLES 3.0),
+	// mappable buffers and a way to know when the GPU is done with them
+	int gl_major = 0;
+	const char *gl_version = (const char *)glGetString(GL_VERSION);
+	if (gl_version == NULL ||
+			sscanf(gl_version, "OpenGL ES %d", &gl_major) != 1) {
+		gl_major = 0;
+	}
+	renderer->gl_major_version = gl_major;
+	if ((gl_major >= 3 || check_gl_ext(exts_str, "GL_NV_pixel_buffer_object")) &&
+			check_gl_ext(exts_str, "GL_EXT_map_buffer_range") &&
+			renderer->egl->exts.fence_sync_khr) {
+		renderer->exts.pixel_buffer_object = true;
+		load_gl_proc(&renderer->procs.glMapBufferRangeEXT,
+			"glMapBufferRangeEXT");
+		for (size_t i = 0; i < WLR_GLES2_UPLOAD_RING_LEN; i++) {
+			renderer->upload_buffers[i].fence = EGL_NO_SYNC_KHR;
+		}
+	}
+
+	if (renderer->exts.pixel_buffer_object &&
+			check_gl_ext(exts_str, "GL_EXT_buffer_storage")) {
+		renderer->exts.buffer_storage_ext = true;
+		load_gl_proc(&renderer->procs.glBufferStorageEXT,
+			"glBufferStorageEXT");
+	} else {
+		wlr_log(WLR_DEBUG, "Persistent pixel buffer objects not supported, "
+			"texture uploads will be synchronous");
+	}
+
+	if (renderer->exts.pixel_buffer_object &&
+			check_gl_ext(exts_str, "GL_OES_mapbuffer")) {
+		renderer->exts.mapbuffer_oes = true;
+		load_gl_proc(&renderer->procs.glUnmapBufferOES, "glUnmapBufferOES");
+	} else {
+		wlr_log(WLR_DEBUG, "GL_OES_mapbuffer not supported, "
+			"pixel reads will be synchronous");
+	}
+
 	if (renderer->exts.debug_khr) {
 		glEnable(GL_DEBUG_OUTPUT_KHR);
 		glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS_KHR);
@@ -797,6 +998,19 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 			GL_DEBUG_TYPE_PUSH_GROUP_KHR, GL_DONT_CARE, 0, NULL, GL_FALSE);
 	}
 
+	if (check_gl_ext(exts_str, "GL_OES_get_program_binary")) {
+		GLint formats_len = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS_OES, &formats_len);
+		if (formats_len > 0) {
+			renderer->exts.get_program_binary_oes = true;
+			load_gl_proc(&renderer->procs.glGetProgramBinaryOES,
+				"glGetProgramBinaryOES");
+			load_gl_proc(&renderer->procs.glProgramBinaryOES,
+				"glProgramBinaryOES");
+			renderer->program_cache_dir = gles2_get_program_cache_dir();
+		}
+	}
+
 	push_gles2_debug(renderer);
 
 	GLuint prog;
@@ -849,6 +1063,9 @@ struct wlr_renderer *wlr_gles2_renderer_create(struct wlr_egl *egl) {
 
 	pop_gles2_debug(renderer);
 
+	free(renderer->program_cache_dir);
+	renderer->program_cache_dir = NULL;
+
 	wlr_egl_unset_current(renderer->egl);
 
 	return &renderer->wlr_renderer;
@@ -861,6 +1078,8 @@ error:
 
 	pop_gles2_debug(renderer);
 
+	free(renderer->program_cache_dir);
+
 	if (renderer->exts.debug_khr) {
 		glDisable(GL_DEBUG_OUTPUT_KHR);
 		renderer->procs.glDebugMessageCallbackKHR(NULL, NULL);
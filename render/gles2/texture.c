@@ -4,6 +4,7 @@
 #include <GLES2/gl2ext.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wayland-server-protocol.h>
 #include <wayland-util.h>
 #include <wlr/render/egl.h>
@@ -98,6 +99,151 @@ static bool gles2_texture_write_pixels(struct wlr_texture *wlr_texture,
 	return true;
 }
 
+static void write_region_direct(const struct wlr_gles2_pixel_format *fmt,
+		const struct wlr_pixel_format_info *drm_fmt, uint32_t stride,
+		pixman_box32_t *rects, int rects_len, const void *data) {
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, stride / (drm_fmt->bpp / 8));
+
+	for (int i = 0; i < rects_len; i++) {
+		pixman_box32_t *r = &rects[i];
+		glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, r->x1);
+		glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, r->y1);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, r->x1, r->y1,
+			r->x2 - r->x1, r->y2 - r->y1, fmt->gl_format, fmt->gl_type, data);
+	}
+
+	glPixelStorei(GL_UNPACK_ROW_LENGTH_EXT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_PIXELS_EXT, 0);
+	glPixelStorei(GL_UNPACK_SKIP_ROWS_EXT, 0);
+}
+
+static bool write_region_streaming(struct wlr_gles2_texture *texture,
+		const struct wlr_gles2_pixel_format *fmt,
+		const struct wlr_pixel_format_info *drm_fmt, uint32_t stride,
+		pixman_box32_t *rects, int rects_len, const void *data) {
+	uint32_t bytes_per_pixel = drm_fmt->bpp / 8;
+
+	size_t size = 0;
+	for (int i = 0; i < rects_len; i++) {
+		pixman_box32_t *r = &rects[i];
+		size += (size_t)(r->x2 - r->x1) * (r->y2 - r->y1) * bytes_per_pixel;
+	}
+	if (size == 0) {
+		return true;
+	}
+
+	struct wlr_gles2_upload_buffer *upload =
+		gles2_get_upload_buffer(texture->renderer, size);
+	if (upload == NULL) {
+		return false;
+	}
+
+	// Pack the damaged rows tightly into the staging buffer, the GPU copies
+	// them into the texture asynchronously
+	size_t offset = 0;
+	for (int i = 0; i < rects_len; i++) {
+		pixman_box32_t *r = &rects[i];
+		size_t row_size = (size_t)(r->x2 - r->x1) * bytes_per_pixel;
+		for (int32_t y = r->y1; y < r->y2; y++) {
+			const char *src = (const char *)data + (size_t)y * stride +
+				(size_t)r->x1 * bytes_per_pixel;
+			memcpy((char *)upload->data + offset, src, row_size);
+			offset += row_size;
+		}
+	}
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER_NV, upload->pbo);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	offset = 0;
+	for (int i = 0; i < rects_len; i++) {
+		pixman_box32_t *r = &rects[i];
+		glTexSubImage2D(GL_TEXTURE_2D, 0, r->x1, r->y1,
+			r->x2 - r->x1, r->y2 - r->y1, fmt->gl_format, fmt->gl_type,
+			(const void *)(uintptr_t)offset);
+		offset += (size_t)(r->x2 - r->x1) * (r->y2 - r->y1) * bytes_per_pixel;
+	}
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER_NV, 0);
+
+	gles2_upload_buffer_fence(texture->renderer, upload);
+
+	return true;
+}
+
+static bool gles2_texture_write_pixels_region(struct wlr_texture *wlr_texture,
+		uint32_t stride, pixman_region32_t *region, const void *data) {
+	struct wlr_gles2_texture *texture = gles2_get_texture(wlr_texture);
+
+	if (texture->target != GL_TEXTURE_2D) {
+		wlr_log(WLR_ERROR, "Cannot write pixels to immutable texture");
+		return false;
+	}
+
+	const struct wlr_gles2_pixel_format *fmt =
+		get_gles2_format_from_drm(texture->drm_format);
+	assert(fmt);
+
+	const struct wlr_pixel_format_info *drm_fmt =
+		drm_get_pixel_format_info(texture->drm_format);
+	assert(drm_fmt);
+
+	if (!check_stride(drm_fmt, stride, wlr_texture->width)) {
+		return false;
+	}
+
+	int rects_len;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &rects_len);
+	if (rects_len == 0) {
+		return true;
+	}
+
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(texture->renderer->egl);
+
+	push_gles2_debug(texture->renderer);
+
+	glBindTexture(GL_TEXTURE_2D, texture->tex);
+
+	if (!write_region_streaming(texture, fmt, drm_fmt, stride,
+			rects, rects_len, data)) {
+		write_region_direct(fmt, drm_fmt, stride,
+			rects, rects_len, data);
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	pop_gles2_debug(texture->renderer);
+
+	wlr_egl_restore_context(&prev_ctx);
+
+	return true;
+}
+
+static void gles2_texture_invalidate(struct wlr_texture *wlr_texture) {
+	struct wlr_gles2_texture *texture = gles2_get_texture(wlr_texture);
+	if (texture->image == EGL_NO_IMAGE_KHR) {
+		return;
+	}
+	// Re-bind the image so that drivers don't sample stale contents
+	struct wlr_egl_context prev_ctx;
+	wlr_egl_save_context(&prev_ctx);
+	wlr_egl_make_current(texture->renderer->egl);
+
+	push_gles2_debug(texture->renderer);
+
+	glBindTexture(texture->target, texture->tex);
+	texture->renderer->procs.glEGLImageTargetTexture2DOES(texture->target,
+		texture->image);
+	glBindTexture(texture->target, 0);
+
+	pop_gles2_debug(texture->renderer);
+
+	wlr_egl_restore_context(&prev_ctx);
+}
+
 static void gles2_texture_destroy(struct wlr_texture *wlr_texture) {
 	if (wlr_texture == NULL) {
 		return;
@@ -124,6 +270,8 @@ static void gles2_texture_destroy(struct wlr_texture *wlr_texture) {
 static const struct wlr_texture_impl texture_impl = {
 	.is_opaque = gles2_texture_is_opaque,
 	.write_pixels = gles2_texture_write_pixels,
+	.write_pixels_region = gles2_texture_write_pixels_region,
+	.invalidate = gles2_texture_invalidate,
 	.destroy = gles2_texture_destroy,
 };
 
@@ -0,0 +1,60 @@
+#include <drm_fourcc.h>
+#include <wlr/util/log.h>
+#include "render/pixman.h"
+
+/*
+ * The DRM formats are little-endian, the pixman formats are defined in terms
+ * of native-endian 32-bit words.
+ */
+static const struct wlr_pixman_pixel_format formats[] = {
+	{
+		.drm_format = DRM_FORMAT_ARGB8888,
+		.pixman_format = PIXMAN_a8r8g8b8,
+	},
+	{
+		.drm_format = DRM_FORMAT_XRGB8888,
+		.pixman_format = PIXMAN_x8r8g8b8,
+	},
+	{
+		.drm_format = DRM_FORMAT_ABGR8888,
+		.pixman_format = PIXMAN_a8b8g8r8,
+	},
+	{
+		.drm_format = DRM_FORMAT_XBGR8888,
+		.pixman_format = PIXMAN_x8b8g8r8,
+	},
+};
+
+static const size_t formats_len = sizeof(formats) / sizeof(formats[0]);
+
+pixman_format_code_t get_pixman_format_from_drm(uint32_t fmt) {
+	for (size_t i = 0; i < formats_len; ++i) {
+		if (formats[i].drm_format == fmt) {
+			return formats[i].pixman_format;
+		}
+	}
+
+	wlr_log(WLR_ERROR, "DRM format 0x%"PRIX32" has no pixman equivalent", fmt);
+	return 0;
+}
+
+uint32_t get_drm_format_from_pixman(pixman_format_code_t fmt) {
+	for (size_t i = 0; i < formats_len; ++i) {
+		if (formats[i].pixman_format == fmt) {
+			return formats[i].drm_format;
+		}
+	}
+
+	wlr_log(WLR_ERROR, "pixman format 0x%"PRIX32" has no drm equivalent",
+		(uint32_t)fmt);
+	return DRM_FORMAT_INVALID;
+}
+
+const uint32_t *get_pixman_drm_formats(size_t *len) {
+	static uint32_t drm_formats[sizeof(formats) / sizeof(formats[0])];
+	*len = formats_len;
+	for (size_t i = 0; i < formats_len; ++i) {
+		drm_formats[i] = formats[i].drm_format;
+	}
+	return drm_formats;
+}
@@ -0,0 +1,729 @@
+#include <assert.h>
+#include <drm_fourcc.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/render/interface.h>
+#include <wlr/types/wlr_matrix.h>
+#include <wlr/util/log.h>
+#include "render/pixman.h"
+#include "types/wlr_buffer.h"
+
+static const struct wlr_renderer_impl renderer_impl;
+
+bool wlr_renderer_is_pixman(struct wlr_renderer *wlr_renderer) {
+	return wlr_renderer->impl == &renderer_impl;
+}
+
+static struct wlr_pixman_renderer *get_renderer(
+		struct wlr_renderer *wlr_renderer) {
+	assert(wlr_renderer_is_pixman(wlr_renderer));
+	return (struct wlr_pixman_renderer *)wlr_renderer;
+}
+
+static struct wlr_pixman_renderer *get_renderer_in_context(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+	assert(renderer->current_buffer != NULL);
+	return renderer;
+}
+
+static const struct wlr_texture_impl texture_impl;
+
+bool wlr_texture_is_pixman(struct wlr_texture *texture) {
+	return texture->impl == &texture_impl;
+}
+
+static struct wlr_pixman_texture *get_texture(
+		struct wlr_texture *wlr_texture) {
+	assert(wlr_texture_is_pixman(wlr_texture));
+	return (struct wlr_pixman_texture *)wlr_texture;
+}
+
+static bool check_stride(const struct wlr_pixel_format_info *fmt,
+		uint32_t stride, uint32_t width) {
+	if (stride % (fmt->bpp / 8) != 0) {
+		wlr_log(WLR_ERROR, "Invalid stride %d (incompatible with %d "
+			"bytes-per-pixel)", stride, fmt->bpp / 8);
+		return false;
+	}
+	if (stride < width * (fmt->bpp / 8)) {
+		wlr_log(WLR_ERROR, "Invalid stride %d (too small for %d "
+			"bytes-per-pixel and width %d)", stride, fmt->bpp / 8, width);
+		return false;
+	}
+	return true;
+}
+
+static struct pixman_color color_to_pixman(const float color[static 4]) {
+	// Colors are pre-multiplied
+	return (struct pixman_color){
+		.red = color[0] * 0xFFFF,
+		.green = color[1] * 0xFFFF,
+		.blue = color[2] * 0xFFFF,
+		.alpha = color[3] * 0xFFFF,
+	};
+}
+
+/**
+ * Converts a matrix mapping the unit square to the buffer into the pixman
+ * transform mapping buffer coordinates back to source coordinates.
+ */
+static bool matrix_to_pixman_transform(struct pixman_transform *transform,
+		const float mat[static 9]) {
+	struct pixman_f_transform ftr = {
+		.m = {
+			{ mat[0], mat[1], mat[2] },
+			{ mat[3], mat[4], mat[5] },
+			{ mat[6], mat[7], mat[8] },
+		},
+	};
+
+	struct pixman_f_transform inv;
+	if (!pixman_f_transform_invert(&inv, &ftr)) {
+		return false;
+	}
+
+	pixman_transform_from_pixman_f_transform(transform, &inv);
+	return true;
+}
+
+static void destroy_buffer(struct wlr_pixman_buffer *buffer) {
+	wl_list_remove(&buffer->link);
+	wl_list_remove(&buffer->buffer_destroy.link);
+
+	pixman_image_unref(buffer->image);
+
+	free(buffer);
+}
+
+static struct wlr_pixman_buffer *get_buffer(
+		struct wlr_pixman_renderer *renderer, struct wlr_buffer *wlr_buffer) {
+	struct wlr_pixman_buffer *buffer;
+	wl_list_for_each(buffer, &renderer->buffers, link) {
+		if (buffer->buffer == wlr_buffer) {
+			return buffer;
+		}
+	}
+	return NULL;
+}
+
+static void handle_buffer_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_pixman_buffer *buffer =
+		wl_container_of(listener, buffer, buffer_destroy);
+	destroy_buffer(buffer);
+}
+
+static pixman_image_t *create_buffer_image(struct wlr_buffer *wlr_buffer,
+		void *data, uint32_t drm_format, size_t stride) {
+	pixman_format_code_t format = get_pixman_format_from_drm(drm_format);
+	if (format == 0) {
+		wlr_log(WLR_ERROR, "Unsupported pixman drm format 0x%"PRIX32,
+			drm_format);
+		return NULL;
+	}
+
+	return pixman_image_create_bits_no_clear(format, wlr_buffer->width,
+		wlr_buffer->height, data, stride);
+}
+
+static struct wlr_pixman_buffer *create_buffer(
+		struct wlr_pixman_renderer *renderer, struct wlr_buffer *wlr_buffer,
+		void *data, uint32_t drm_format, size_t stride) {
+	struct wlr_pixman_buffer *buffer = calloc(1, sizeof(*buffer));
+	if (buffer == NULL) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	buffer->buffer = wlr_buffer;
+	buffer->renderer = renderer;
+
+	buffer->image = create_buffer_image(wlr_buffer, data, drm_format, stride);
+	if (buffer->image == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create pixman image");
+		free(buffer);
+		return NULL;
+	}
+	buffer->data = data;
+
+	buffer->buffer_destroy.notify = handle_buffer_destroy;
+	wl_signal_add(&wlr_buffer->events.destroy, &buffer->buffer_destroy);
+
+	wl_list_insert(&renderer->buffers, &buffer->link);
+
+	wlr_log(WLR_DEBUG, "Created pixman image for buffer %dx%d",
+		wlr_buffer->width, wlr_buffer->height);
+
+	return buffer;
+}
+
+static void pixman_begin(struct wlr_renderer *wlr_renderer, uint32_t width,
+		uint32_t height) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	renderer->width = width;
+	renderer->height = height;
+
+	pixman_image_set_clip_region32(renderer->current_buffer->image, NULL);
+}
+
+static void pixman_clear(struct wlr_renderer *wlr_renderer,
+		const float color[static 4]) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
+
+	struct pixman_color pixman_color = color_to_pixman(color);
+	pixman_image_t *fill = pixman_image_create_solid_fill(&pixman_color);
+
+	pixman_image_composite32(PIXMAN_OP_SRC, fill, NULL, buffer->image,
+		0, 0, 0, 0, 0, 0, renderer->width, renderer->height);
+
+	pixman_image_unref(fill);
+}
+
+static void pixman_scissor(struct wlr_renderer *wlr_renderer,
+		struct wlr_box *box) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
+
+	if (box != NULL) {
+		pixman_region32_t region;
+		pixman_region32_init_rect(&region, box->x, box->y,
+			box->width, box->height);
+		pixman_image_set_clip_region32(buffer->image, &region);
+		pixman_region32_fini(&region);
+	} else {
+		pixman_image_set_clip_region32(buffer->image, NULL);
+	}
+}
+
+/**
+ * Computes the part of the render area covered by the unit square transformed
+ * by the matrix. Returns false if it's empty.
+ */
+static bool get_render_bounds(struct wlr_pixman_renderer *renderer,
+		const float mat[static 9], struct wlr_box *bounds) {
+	const float corners[4][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 } };
+	float x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+	for (size_t i = 0; i < 4; ++i) {
+		float x = mat[0] * corners[i][0] + mat[1] * corners[i][1] + mat[2];
+		float y = mat[3] * corners[i][0] + mat[4] * corners[i][1] + mat[5];
+		x1 = fminf(x1, x);
+		y1 = fminf(y1, y);
+		x2 = fmaxf(x2, x);
+		y2 = fmaxf(y2, y);
+	}
+
+	int bx1 = fmaxf(floorf(x1), 0);
+	int by1 = fmaxf(floorf(y1), 0);
+	int bx2 = fminf(ceilf(x2), renderer->width);
+	int by2 = fminf(ceilf(y2), renderer->height);
+	if (bx2 <= bx1 || by2 <= by1) {
+		return false;
+	}
+
+	bounds->x = bx1;
+	bounds->y = by1;
+	bounds->width = bx2 - bx1;
+	bounds->height = by2 - by1;
+	return true;
+}
+
+/**
+ * Makes the texture's pixels accessible for sampling. Textures created from
+ * buffers access the buffer's memory directly, which may have moved since the
+ * last access.
+ */
+static bool texture_begin_access(struct wlr_pixman_texture *texture) {
+	if (texture->buffer == NULL) {
+		return true;
+	}
+
+	void *data;
+	uint32_t drm_format;
+	size_t stride;
+	if (!buffer_begin_data_ptr_access(texture->buffer, &data, &drm_format,
+			&stride)) {
+		wlr_log(WLR_ERROR, "Failed to access texture buffer data");
+		return false;
+	}
+
+	if (data != texture->data) {
+		pixman_image_t *image = pixman_image_create_bits_no_clear(
+			texture->format, texture->wlr_texture.width,
+			texture->wlr_texture.height, data, stride);
+		if (image == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create pixman image");
+			buffer_end_data_ptr_access(texture->buffer);
+			return false;
+		}
+		if (texture->image != NULL) {
+			pixman_image_unref(texture->image);
+		}
+		texture->image = image;
+		texture->data = data;
+	}
+
+	return true;
+}
+
+static void texture_end_access(struct wlr_pixman_texture *texture) {
+	if (texture->buffer != NULL) {
+		buffer_end_data_ptr_access(texture->buffer);
+	}
+}
+
+static bool pixman_render_subtexture_with_matrix(
+		struct wlr_renderer *wlr_renderer, struct wlr_texture *wlr_texture,
+		const struct wlr_fbox *box, const float matrix[static 9],
+		float alpha) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
+
+	if (box->width <= 0 || box->height <= 0) {
+		return true;
+	}
+
+	struct wlr_box bounds;
+	if (!get_render_bounds(renderer, matrix, &bounds)) {
+		return true;
+	}
+
+	if (!texture_begin_access(texture)) {
+		return false;
+	}
+
+	// Sample from a view of the texture restricted to the sub-box, so that
+	// pixels outside of it never leak into the destination
+	pixman_image_t *src = texture->image;
+	int src_x = floor(box->x);
+	int src_y = floor(box->y);
+	int src_width = ceil(box->x + box->width) - src_x;
+	int src_height = ceil(box->y + box->height) - src_y;
+	if (src_x != 0 || src_y != 0 ||
+			(uint32_t)src_width != wlr_texture->width ||
+			(uint32_t)src_height != wlr_texture->height) {
+		int stride = pixman_image_get_stride(texture->image);
+		unsigned char *data = (unsigned char *)texture->data +
+			src_y * stride + src_x * (texture->format_info->bpp / 8);
+		src = pixman_image_create_bits_no_clear(texture->format,
+			src_width, src_height, (uint32_t *)data, stride);
+		if (src == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create pixman image");
+			texture_end_access(texture);
+			return false;
+		}
+	} else {
+		pixman_image_ref(src);
+	}
+
+	// The matrix maps the unit square to the buffer, make it map the
+	// sub-box instead
+	float mat[9];
+	memcpy(mat, matrix, sizeof(mat));
+	wlr_matrix_scale(mat, 1.0 / box->width, 1.0 / box->height);
+	wlr_matrix_translate(mat, src_x - box->x, src_y - box->y);
+
+	struct pixman_transform transform;
+	if (!matrix_to_pixman_transform(&transform, mat)) {
+		wlr_log(WLR_ERROR, "Failed to render texture: singular matrix");
+		pixman_image_unref(src);
+		texture_end_access(texture);
+		return false;
+	}
+	pixman_image_set_transform(src, &transform);
+
+	pixman_image_t *mask = NULL;
+	if (alpha < 1.0) {
+		struct pixman_color mask_color = { .alpha = alpha * 0xFFFF };
+		mask = pixman_image_create_solid_fill(&mask_color);
+	}
+
+	pixman_op_t op = PIXMAN_OP_OVER;
+	if (mask == NULL && !texture->format_info->has_alpha) {
+		op = PIXMAN_OP_SRC;
+	}
+
+	pixman_image_composite32(op, src, mask, buffer->image,
+		bounds.x, bounds.y, 0, 0, bounds.x, bounds.y,
+		bounds.width, bounds.height);
+
+	if (mask != NULL) {
+		pixman_image_unref(mask);
+	}
+	pixman_image_set_transform(src, NULL);
+	pixman_image_unref(src);
+
+	texture_end_access(texture);
+
+	return true;
+}
+
+static void pixman_render_quad_with_matrix(struct wlr_renderer *wlr_renderer,
+		const float color[static 4], const float matrix[static 9]) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
+
+	struct wlr_box bounds;
+	if (!get_render_bounds(renderer, matrix, &bounds)) {
+		return;
+	}
+
+	struct pixman_transform transform;
+	if (!matrix_to_pixman_transform(&transform, matrix)) {
+		wlr_log(WLR_ERROR, "Failed to render quad: singular matrix");
+		return;
+	}
+
+	// A single-pixel source image stretched over the unit square by the
+	// transform covers exactly the quad, whatever its orientation
+	uint32_t pixel = ((uint32_t)(color[3] * 0xFF) << 24) |
+		((uint32_t)(color[0] * 0xFF) << 16) |
+		((uint32_t)(color[1] * 0xFF) << 8) |
+		(uint32_t)(color[2] * 0xFF);
+	pixman_image_t *quad =
+		pixman_image_create_bits(PIXMAN_a8r8g8b8, 1, 1, &pixel, 4);
+	if (quad == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create pixman image");
+		return;
+	}
+	pixman_image_set_transform(quad, &transform);
+	pixman_image_set_filter(quad, PIXMAN_FILTER_NEAREST, NULL, 0);
+
+	pixman_image_composite32(PIXMAN_OP_OVER, quad, NULL, buffer->image,
+		bounds.x, bounds.y, 0, 0, bounds.x, bounds.y,
+		bounds.width, bounds.height);
+
+	pixman_image_unref(quad);
+}
+
+static const uint32_t *pixman_get_shm_texture_formats(
+		struct wlr_renderer *wlr_renderer, size_t *len) {
+	return get_pixman_drm_formats(len);
+}
+
+static const struct wlr_drm_format_set *pixman_get_render_formats(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+	return &renderer->drm_formats;
+}
+
+static uint32_t pixman_get_render_buffer_caps(
+		struct wlr_renderer *wlr_renderer) {
+	return WLR_BUFFER_CAP_DATA_PTR;
+}
+
+static bool pixman_texture_is_opaque(struct wlr_texture *wlr_texture) {
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+	return !texture->format_info->has_alpha;
+}
+
+static bool pixman_texture_write_pixels(struct wlr_texture *wlr_texture,
+		uint32_t stride, uint32_t width, uint32_t height,
+		uint32_t src_x, uint32_t src_y, uint32_t dst_x, uint32_t dst_y,
+		const void *data) {
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+
+	if (texture->buffer != NULL) {
+		// The texture doesn't own its pixels
+		return false;
+	}
+
+	if (!check_stride(texture->format_info, stride, width)) {
+		return false;
+	}
+
+	uint32_t bytes_pp = texture->format_info->bpp / 8;
+	uint32_t tex_stride = pixman_image_get_stride(texture->image);
+	const unsigned char *src = (const unsigned char *)data +
+		src_y * stride + src_x * bytes_pp;
+	unsigned char *dst = (unsigned char *)texture->data +
+		dst_y * tex_stride + dst_x * bytes_pp;
+	for (uint32_t i = 0; i < height; ++i) {
+		memcpy(dst + i * tex_stride, src + i * stride, width * bytes_pp);
+	}
+
+	return true;
+}
+
+static void pixman_texture_destroy(struct wlr_texture *wlr_texture) {
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+	pixman_image_unref(texture->image);
+	if (texture->buffer != NULL) {
+		wlr_buffer_unlock(texture->buffer);
+	} else {
+		free(texture->data);
+	}
+	free(texture);
+}
+
+static const struct wlr_texture_impl texture_impl = {
+	.is_opaque = pixman_texture_is_opaque,
+	.write_pixels = pixman_texture_write_pixels,
+	.destroy = pixman_texture_destroy,
+};
+
+static struct wlr_pixman_texture *pixman_texture_create(
+		struct wlr_pixman_renderer *renderer, uint32_t drm_format,
+		uint32_t stride, uint32_t width, uint32_t height) {
+	pixman_format_code_t format = get_pixman_format_from_drm(drm_format);
+	if (format == 0) {
+		wlr_log(WLR_ERROR, "Unsupported pixel format 0x%"PRIX32, drm_format);
+		return NULL;
+	}
+
+	const struct wlr_pixel_format_info *drm_fmt =
+		drm_get_pixel_format_info(drm_format);
+	assert(drm_fmt);
+
+	if (!check_stride(drm_fmt, stride, width)) {
+		return NULL;
+	}
+
+	struct wlr_pixman_texture *texture = calloc(1, sizeof(*texture));
+	if (texture == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+	wlr_texture_init(&texture->wlr_texture, &texture_impl, width, height);
+	texture->renderer = renderer;
+	texture->format = format;
+	texture->format_info = drm_fmt;
+
+	return texture;
+}
+
+static struct wlr_texture *pixman_texture_from_pixels(
+		struct wlr_renderer *wlr_renderer, uint32_t drm_format,
+		uint32_t stride, uint32_t width, uint32_t height, const void *data) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+
+	struct wlr_pixman_texture *texture =
+		pixman_texture_create(renderer, drm_format, stride, width, height);
+	if (texture == NULL) {
+		return NULL;
+	}
+	pixman_format_code_t format = texture->format;
+
+	// Keep our own copy of the pixels: the caller's data may go away as soon
+	// as we return (e.g. a wl_shm buffer which gets released)
+	texture->data = malloc((size_t)stride * height);
+	if (texture->data == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		free(texture);
+		return NULL;
+	}
+	memcpy(texture->data, data, (size_t)stride * height);
+
+	texture->image = pixman_image_create_bits_no_clear(format, width, height,
+		texture->data, stride);
+	if (texture->image == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create pixman image");
+		free(texture->data);
+		free(texture);
+		return NULL;
+	}
+
+	return &texture->wlr_texture;
+}
+
+static struct wlr_texture *pixman_texture_from_buffer(
+		struct wlr_renderer *wlr_renderer, struct wlr_buffer *buffer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+
+	void *data;
+	uint32_t drm_format;
+	size_t stride;
+	if (!buffer_begin_data_ptr_access(buffer, &data, &drm_format, &stride)) {
+		return NULL;
+	}
+	buffer_end_data_ptr_access(buffer);
+
+	struct wlr_pixman_texture *texture = pixman_texture_create(renderer,
+		drm_format, stride, buffer->width, buffer->height);
+	if (texture == NULL) {
+		return NULL;
+	}
+	texture->buffer = wlr_buffer_lock(buffer);
+
+	// Create the image right away, so that it's available through
+	// wlr_pixman_texture_get_image
+	if (!texture_begin_access(texture)) {
+		wlr_buffer_unlock(texture->buffer);
+		free(texture);
+		return NULL;
+	}
+	texture_end_access(texture);
+
+	return &texture->wlr_texture;
+}
+
+static bool pixman_bind_buffer(struct wlr_renderer *wlr_renderer,
+		struct wlr_buffer *wlr_buffer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+
+	if (renderer->current_buffer != NULL) {
+		struct wlr_buffer *prev = renderer->current_buffer->buffer;
+		buffer_end_data_ptr_access(prev);
+		wlr_buffer_unlock(prev);
+		renderer->current_buffer = NULL;
+	}
+
+	if (wlr_buffer == NULL) {
+		return true;
+	}
+
+	void *data;
+	uint32_t drm_format;
+	size_t stride;
+	if (!buffer_begin_data_ptr_access(wlr_buffer, &data, &drm_format,
+			&stride)) {
+		wlr_log(WLR_ERROR, "Failed to access buffer data");
+		return false;
+	}
+
+	struct wlr_pixman_buffer *buffer = get_buffer(renderer, wlr_buffer);
+	if (buffer != NULL && buffer->data != data) {
+		// The buffer has been re-mapped somewhere else since last time
+		pixman_image_t *image =
+			create_buffer_image(wlr_buffer, data, drm_format, stride);
+		if (image == NULL) {
+			buffer_end_data_ptr_access(wlr_buffer);
+			return false;
+		}
+		pixman_image_unref(buffer->image);
+		buffer->image = image;
+		buffer->data = data;
+	} else if (buffer == NULL) {
+		buffer = create_buffer(renderer, wlr_buffer, data, drm_format, stride);
+	}
+	if (buffer == NULL) {
+		buffer_end_data_ptr_access(wlr_buffer);
+		return false;
+	}
+
+	wlr_buffer_lock(wlr_buffer);
+	renderer->current_buffer = buffer;
+
+	return true;
+}
+
+static uint32_t pixman_preferred_read_format(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	pixman_format_code_t format =
+		pixman_image_get_format(renderer->current_buffer->image);
+	return get_drm_format_from_pixman(format);
+}
+
+static bool pixman_read_pixels(struct wlr_renderer *wlr_renderer,
+		uint32_t drm_format, uint32_t *flags, uint32_t stride,
+		uint32_t width, uint32_t height, uint32_t src_x, uint32_t src_y,
+		uint32_t dst_x, uint32_t dst_y, void *data) {
+	struct wlr_pixman_renderer *renderer =
+		get_renderer_in_context(wlr_renderer);
+	struct wlr_pixman_buffer *buffer = renderer->current_buffer;
+
+	pixman_format_code_t format = get_pixman_format_from_drm(drm_format);
+	if (format == 0) {
+		wlr_log(WLR_ERROR, "Cannot read pixels: unsupported pixel format");
+		return false;
+	}
+
+	pixman_image_t *dst = pixman_image_create_bits_no_clear(format,
+		dst_x + width, dst_y + height, data, stride);
+	if (dst == NULL) {
+		wlr_log(WLR_ERROR, "Failed to create pixman image");
+		return false;
+	}
+
+	pixman_image_composite32(PIXMAN_OP_SRC, buffer->image, NULL, dst,
+		src_x, src_y, 0, 0, dst_x, dst_y, width, height);
+
+	pixman_image_unref(dst);
+
+	if (flags != NULL) {
+		*flags = 0;
+	}
+
+	return true;
+}
+
+static void pixman_destroy(struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+
+	if (renderer->current_buffer != NULL) {
+		pixman_bind_buffer(wlr_renderer, NULL);
+	}
+
+	struct wlr_pixman_buffer *buffer, *buffer_tmp;
+	wl_list_for_each_safe(buffer, buffer_tmp, &renderer->buffers, link) {
+		destroy_buffer(buffer);
+	}
+
+	wlr_drm_format_set_finish(&renderer->drm_formats);
+
+	free(renderer);
+}
+
+static const struct wlr_renderer_impl renderer_impl = {
+	.destroy = pixman_destroy,
+	.bind_buffer = pixman_bind_buffer,
+	.begin = pixman_begin,
+	.clear = pixman_clear,
+	.scissor = pixman_scissor,
+	.render_subtexture_with_matrix = pixman_render_subtexture_with_matrix,
+	.render_quad_with_matrix = pixman_render_quad_with_matrix,
+	.get_shm_texture_formats = pixman_get_shm_texture_formats,
+	.get_render_formats = pixman_get_render_formats,
+	.preferred_read_format = pixman_preferred_read_format,
+	.read_pixels = pixman_read_pixels,
+	.texture_from_pixels = pixman_texture_from_pixels,
+	.texture_from_buffer = pixman_texture_from_buffer,
+	.get_render_buffer_caps = pixman_get_render_buffer_caps,
+};
+
+struct wlr_renderer *wlr_pixman_renderer_create(void) {
+	struct wlr_pixman_renderer *renderer = calloc(1, sizeof(*renderer));
+	if (renderer == NULL) {
+		return NULL;
+	}
+
+	wlr_log(WLR_INFO, "Creating pixman renderer");
+	wlr_renderer_init(&renderer->wlr_renderer, &renderer_impl);
+	wl_list_init(&renderer->buffers);
+
+	size_t len = 0;
+	const uint32_t *formats = get_pixman_drm_formats(&len);
+	for (size_t i = 0; i < len; ++i) {
+		if (!wlr_drm_format_set_add(&renderer->drm_formats, formats[i],
+				DRM_FORMAT_MOD_INVALID)) {
+			wlr_log(WLR_ERROR, "Failed to add format 0x%"PRIX32, formats[i]);
+			wlr_drm_format_set_finish(&renderer->drm_formats);
+			free(renderer);
+			return NULL;
+		}
+	}
+
+	return &renderer->wlr_renderer;
+}
+
+pixman_image_t *wlr_pixman_renderer_get_current_image(
+		struct wlr_renderer *wlr_renderer) {
+	struct wlr_pixman_renderer *renderer = get_renderer(wlr_renderer);
+	if (renderer->current_buffer == NULL) {
+		return NULL;
+	}
+	return renderer->current_buffer->image;
+}
+
+pixman_image_t *wlr_pixman_texture_get_image(struct wlr_texture *wlr_texture) {
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+	return texture->image;
+}
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/util/log.h>
 #include <wlr/types/wlr_buffer.h>
 #include "render/allocator.h"
@@ -51,11 +52,57 @@ void wlr_swapchain_destroy(struct wlr_swapchain *swapchain) {
 	for (size_t i = 0; i < WLR_SWAPCHAIN_CAP; i++) {
 		slot_reset(&swapchain->slots[i]);
 	}
+	for (size_t i = 0; i < WLR_SWAPCHAIN_POOL_CAP; i++) {
+		wlr_buffer_drop(swapchain->pool[i]);
+	}
 	wl_list_remove(&swapchain->allocator_destroy.link);
 	free(swapchain->format);
 	free(swapchain);
 }
 
+static void pool_add(struct wlr_swapchain *swapchain,
+		struct wlr_buffer *buffer) {
+	wlr_buffer_drop(swapchain->pool[WLR_SWAPCHAIN_POOL_CAP - 1]);
+	memmove(&swapchain->pool[1], &swapchain->pool[0],
+		(WLR_SWAPCHAIN_POOL_CAP - 1) * sizeof(swapchain->pool[0]));
+	swapchain->pool[0] = buffer;
+}
+
+static struct wlr_buffer *pool_take(struct wlr_swapchain *swapchain) {
+	for (size_t i = 0; i < WLR_SWAPCHAIN_POOL_CAP; i++) {
+		struct wlr_buffer *buffer = swapchain->pool[i];
+		if (buffer == NULL || buffer->width != swapchain->width ||
+				buffer->height != swapchain->height) {
+			continue;
+		}
+		memmove(&swapchain->pool[i], &swapchain->pool[i + 1],
+			(WLR_SWAPCHAIN_POOL_CAP - i - 1) * sizeof(swapchain->pool[0]));
+		swapchain->pool[WLR_SWAPCHAIN_POOL_CAP - 1] = NULL;
+		return buffer;
+	}
+	return NULL;
+}
+
+void wlr_swapchain_resize(struct wlr_swapchain *swapchain,
+		int width, int height) {
+	if (swapchain->width == width && swapchain->height == height) {
+		return;
+	}
+
+	for (size_t i = 0; i < WLR_SWAPCHAIN_CAP; i++) {
+		struct wlr_swapchain_slot *slot = &swapchain->slots[i];
+		if (slot->buffer != NULL && !slot->acquired) {
+			pool_add(swapchain, slot->buffer);
+			memset(slot, 0, sizeof(*slot));
+		} else {
+			slot_reset(slot);
+		}
+	}
+
+	swapchain->width = width;
+	swapchain->height = height;
+}
+
 static void slot_handle_release(struct wl_listener *listener, void *data) {
 	struct wlr_swapchain_slot *slot =
 		wl_container_of(listener, slot, release);
@@ -69,6 +116,7 @@ static struct wlr_buffer *slot_acquire(struct wlr_swapchain *swapchain,
 	assert(slot->buffer != NULL);
 
 	slot->acquired = true;
+	slot->idle_frames = 0;
 
 	slot->release.notify = slot_handle_release;
 	wl_signal_add(&slot->buffer->events.release, &slot->release);
@@ -102,6 +150,11 @@ struct wlr_buffer *wlr_swapchain_acquire(struct wlr_swapchain *swapchain,
 		return NULL;
 	}
 
+	free_slot->buffer = pool_take(swapchain);
+	if (free_slot->buffer != NULL) {
+		return slot_acquire(swapchain, free_slot, age);
+	}
+
 	wlr_log(WLR_DEBUG, "Allocating new swapchain buffer");
 	free_slot->buffer = wlr_allocator_create_buffer(swapchain->allocator,
 		swapchain->width, swapchain->height, swapchain->format);
@@ -133,6 +186,7 @@ void wlr_swapchain_set_buffer_submitted(struct wlr_swapchain *swapchain,
 
 	// See the algorithm described in:
 	// https://www.khronos.org/registry/EGL/extensions/EXT/EGL_EXT_buffer_age.txt
+	size_t allocated = 0;
 	for (size_t i = 0; i < WLR_SWAPCHAIN_CAP; i++) {
 		struct wlr_swapchain_slot *slot = &swapchain->slots[i];
 		if (slot->buffer == buffer) {
@@ -140,5 +194,24 @@ void wlr_swapchain_set_buffer_submitted(struct wlr_swapchain *swapchain,
 		} else if (slot->age > 0) {
 			slot->age++;
 		}
+		if (slot->buffer != NULL) {
+			allocated++;
+		}
+	}
+
+	// Release buffers which were only needed during a burst, e.g. when the
+	// compositor or the consumer of the buffers was falling behind
+	for (size_t i = 0; i < WLR_SWAPCHAIN_CAP; i++) {
+		struct wlr_swapchain_slot *slot = &swapchain->slots[i];
+		if (slot->buffer == NULL || slot->acquired) {
+			continue;
+		}
+		slot->idle_frames++;
+		if (slot->idle_frames > WLR_SWAPCHAIN_IDLE_FRAMES &&
+				allocated > WLR_SWAPCHAIN_MIN_BUFFERS) {
+			wlr_log(WLR_DEBUG, "Releasing idle swapchain buffer");
+			slot_reset(slot);
+			allocated--;
+		}
 	}
 }
@@ -1,14 +1,17 @@
 #include <assert.h>
 #include <stdbool.h>
 #include <stdlib.h>
+#include <string.h>
 #include <gbm.h>
 #include <wlr/render/egl.h>
 #include <wlr/render/gles2.h>
 #include <wlr/render/interface.h>
+#include <wlr/render/pixman.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_matrix.h>
 #include <wlr/util/log.h>
 #include "util/signal.h"
+#include "util/trace.h"
 #include "render/pixel_format.h"
 #include "render/wlr_renderer.h"
 #include "backend/backend.h"
@@ -52,19 +55,29 @@ bool wlr_renderer_bind_buffer(struct wlr_renderer *r,
 void wlr_renderer_begin(struct wlr_renderer *r, uint32_t width, uint32_t height) {
 	assert(!r->rendering);
 
+	trace_begin("render", NULL, 0);
+
 	r->impl->begin(r, width, height);
 
+	// Backends reset their scissor when starting a new frame
+	r->has_scissor = false;
 	r->rendering = true;
 }
 
 void wlr_renderer_end(struct wlr_renderer *r) {
 	assert(r->rendering);
 
+	if (r->impl->batch_flush) {
+		r->impl->batch_flush(r);
+	}
+
 	if (r->impl->end) {
 		r->impl->end(r);
 	}
 
 	r->rendering = false;
+
+	trace_end("render");
 }
 
 void wlr_renderer_clear(struct wlr_renderer *r, const float color[static 4]) {
@@ -75,6 +88,11 @@ void wlr_renderer_clear(struct wlr_renderer *r, const float color[static 4]) {
 void wlr_renderer_scissor(struct wlr_renderer *r, struct wlr_box *box) {
 	assert(r->rendering);
 	r->impl->scissor(r, box);
+
+	r->has_scissor = box != NULL;
+	if (box != NULL) {
+		r->scissor_box = *box;
+	}
 }
 
 bool wlr_render_texture(struct wlr_renderer *r, struct wlr_texture *texture,
@@ -113,6 +131,40 @@ bool wlr_render_subtexture_with_matrix(struct wlr_renderer *r,
 		box, matrix, alpha);
 }
 
+bool wlr_render_batch_add(struct wlr_renderer *r, struct wlr_texture *texture,
+		const struct wlr_fbox *box, const float matrix[static 9], float alpha,
+		const struct wlr_box *clip) {
+	assert(r->rendering);
+	if (r->impl->batch_add) {
+		return r->impl->batch_add(r, texture, box, matrix, alpha, clip);
+	}
+
+	// Renderer doesn't support batching, draw right away
+	if (clip == NULL) {
+		return r->impl->render_subtexture_with_matrix(r, texture, box,
+			matrix, alpha);
+	}
+
+	struct wlr_box scissor_box = *clip;
+	if (r->has_scissor && !wlr_box_intersection(&scissor_box, &scissor_box,
+			&r->scissor_box)) {
+		return true;
+	}
+
+	r->impl->scissor(r, &scissor_box);
+	bool ok = r->impl->render_subtexture_with_matrix(r, texture, box,
+		matrix, alpha);
+	r->impl->scissor(r, r->has_scissor ? &r->scissor_box : NULL);
+	return ok;
+}
+
+void wlr_render_batch_flush(struct wlr_renderer *r) {
+	assert(r->rendering);
+	if (r->impl->batch_flush) {
+		r->impl->batch_flush(r);
+	}
+}
+
 void wlr_render_rect(struct wlr_renderer *r, const struct wlr_box *box,
 		const float color[static 4], const float projection[static 9]) {
 	if (box->width == 0 || box->height == 0) {
@@ -161,12 +213,19 @@ const struct wlr_drm_format_set *wlr_renderer_get_dmabuf_texture_formats(
 	return r->impl->get_dmabuf_texture_formats(r);
 }
 
-const struct wlr_drm_format_set *wlr_renderer_get_dmabuf_render_formats(
+const struct wlr_drm_format_set *wlr_renderer_get_render_formats(
 		struct wlr_renderer *r) {
-	if (!r->impl->get_dmabuf_render_formats) {
+	if (!r->impl->get_render_formats) {
 		return NULL;
 	}
-	return r->impl->get_dmabuf_render_formats(r);
+	return r->impl->get_render_formats(r);
+}
+
+uint32_t renderer_get_render_buffer_caps(struct wlr_renderer *r) {
+	if (!r->impl->get_render_buffer_caps) {
+		return 0;
+	}
+	return r->impl->get_render_buffer_caps(r);
 }
 
 bool wlr_renderer_read_pixels(struct wlr_renderer *r, uint32_t fmt,
@@ -180,6 +239,50 @@ bool wlr_renderer_read_pixels(struct wlr_renderer *r, uint32_t fmt,
 		src_x, src_y, dst_x, dst_y, data);
 }
 
+struct wlr_render_readback *wlr_renderer_read_pixels_async(
+		struct wlr_renderer *r, uint32_t fmt, uint32_t width, uint32_t height,
+		uint32_t src_x, uint32_t src_y) {
+	if (!r->impl->read_pixels_async) {
+		return NULL;
+	}
+	return r->impl->read_pixels_async(r, fmt, width, height, src_x, src_y);
+}
+
+void wlr_render_readback_init(struct wlr_render_readback *readback,
+		const struct wlr_render_readback_impl *impl, uint32_t format,
+		uint32_t width, uint32_t height) {
+	assert(impl->is_done);
+	assert(impl->copy);
+	assert(impl->destroy);
+	readback->impl = impl;
+	readback->format = format;
+	readback->width = width;
+	readback->height = height;
+}
+
+int wlr_render_readback_get_fd(struct wlr_render_readback *readback) {
+	if (!readback->impl->get_fd) {
+		return -1;
+	}
+	return readback->impl->get_fd(readback);
+}
+
+bool wlr_render_readback_is_done(struct wlr_render_readback *readback) {
+	return readback->impl->is_done(readback);
+}
+
+bool wlr_render_readback_copy(struct wlr_render_readback *readback,
+		uint32_t *flags, uint32_t stride, void *data) {
+	return readback->impl->copy(readback, flags, stride, data);
+}
+
+void wlr_render_readback_destroy(struct wlr_render_readback *readback) {
+	if (readback == NULL) {
+		return;
+	}
+	readback->impl->destroy(readback);
+}
+
 bool wlr_renderer_init_wl_display(struct wlr_renderer *r,
 		struct wl_display *wl_display) {
 	if (wl_display_init_shm(wl_display)) {
@@ -221,7 +324,7 @@ bool wlr_renderer_init_wl_display(struct wlr_renderer *r,
 	return true;
 }
 
-struct wlr_renderer *wlr_renderer_autocreate_with_drm_fd(int drm_fd) {
+static struct wlr_renderer *renderer_autocreate_gles2(int drm_fd) {
 	struct gbm_device *gbm_device = gbm_create_device(drm_fd);
 	if (!gbm_device) {
 		wlr_log(WLR_ERROR, "Failed to create GBM device");
@@ -246,13 +349,43 @@ struct wlr_renderer *wlr_renderer_autocreate_with_drm_fd(int drm_fd) {
 	return renderer;
 }
 
-struct wlr_renderer *wlr_renderer_autocreate(struct wlr_backend *backend) {
-	int drm_fd = backend_get_drm_fd(backend);
-	if (drm_fd < 0) {
-		wlr_log(WLR_ERROR, "Failed to get DRM FD from backend");
+struct wlr_renderer *wlr_renderer_autocreate_with_drm_fd(int drm_fd) {
+	const char *name = getenv("WLR_RENDERER");
+	if (name) {
+		wlr_log(WLR_INFO, "Loading user-specified renderer due to "
+			"WLR_RENDERER: %s", name);
+
+		if (strcmp(name, "gles2") == 0) {
+			if (drm_fd < 0) {
+				wlr_log(WLR_ERROR, "Cannot create GLES2 renderer: "
+					"no DRM FD available");
+				return NULL;
+			}
+			return renderer_autocreate_gles2(drm_fd);
+		} else if (strcmp(name, "pixman") == 0) {
+			return wlr_pixman_renderer_create();
+		}
+
+		wlr_log(WLR_ERROR, "Invalid WLR_RENDERER value: '%s'", name);
 		return NULL;
 	}
 
+	if (drm_fd >= 0) {
+		struct wlr_renderer *renderer = renderer_autocreate_gles2(drm_fd);
+		if (renderer != NULL) {
+			return renderer;
+		}
+		wlr_log(WLR_INFO, "Falling back to the pixman renderer");
+	} else {
+		wlr_log(WLR_INFO, "No DRM FD available, using the pixman renderer");
+	}
+
+	return wlr_pixman_renderer_create();
+}
+
+struct wlr_renderer *wlr_renderer_autocreate(struct wlr_backend *backend) {
+	// If the backend has no DRM FD, this will fall back to a software renderer
+	int drm_fd = backend_get_drm_fd(backend);
 	return wlr_renderer_autocreate_with_drm_fd(drm_fd);
 }
 
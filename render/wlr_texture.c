@@ -42,6 +42,14 @@ struct wlr_texture *wlr_texture_from_dmabuf(struct wlr_renderer *renderer,
 	return renderer->impl->texture_from_dmabuf(renderer, attribs);
 }
 
+struct wlr_texture *wlr_texture_from_buffer(struct wlr_renderer *renderer,
+		struct wlr_buffer *buffer) {
+	if (!renderer->impl->texture_from_buffer) {
+		return NULL;
+	}
+	return renderer->impl->texture_from_buffer(renderer, buffer);
+}
+
 void wlr_texture_get_size(struct wlr_texture *texture, int *width,
 		int *height) {
 	*width = texture->width;
@@ -65,3 +73,29 @@ bool wlr_texture_write_pixels(struct wlr_texture *texture,
 	return texture->impl->write_pixels(texture, stride, width, height,
 		src_x, src_y, dst_x, dst_y, data);
 }
+
+void wlr_texture_invalidate(struct wlr_texture *texture) {
+	if (texture->impl->invalidate) {
+		texture->impl->invalidate(texture);
+	}
+}
+
+bool wlr_texture_write_pixels_region(struct wlr_texture *texture,
+		uint32_t stride, pixman_region32_t *region, const void *data) {
+	if (texture->impl->write_pixels_region) {
+		return texture->impl->write_pixels_region(texture, stride,
+			region, data);
+	}
+
+	int n;
+	pixman_box32_t *rects = pixman_region32_rectangles(region, &n);
+	for (int i = 0; i < n; ++i) {
+		pixman_box32_t *r = &rects[i];
+		if (!wlr_texture_write_pixels(texture, stride,
+				r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
+				r->x1, r->y1, data)) {
+			return false;
+		}
+	}
+	return true;
+}
@@ -0,0 +1,1052 @@
+#include <assert.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/backend.h>
+#include <wlr/render/wlr_renderer.h>
+#include <wlr/types/wlr_matrix.h>
+#include <wlr/types/wlr_output_damage.h>
+#include <wlr/types/wlr_scene.h>
+#include <wlr/types/wlr_surface.h>
+#include <wlr/util/region.h>
+#include "util/signal.h"
+#include "util/time.h"
+
+#define HIDDEN_FRAME_DONE_INTERVAL 1000 // ms
+
+static struct wlr_scene *scene_root_from_node(struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_ROOT);
+	return (struct wlr_scene *)node;
+}
+
+static struct wlr_scene_tree *scene_tree_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_TREE);
+	return (struct wlr_scene_tree *)node;
+}
+
+struct wlr_scene_surface *wlr_scene_surface_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_SURFACE);
+	return (struct wlr_scene_surface *)node;
+}
+
+static struct wlr_scene_rect *scene_rect_from_node(
+		struct wlr_scene_node *node) {
+	assert(node->type == WLR_SCENE_NODE_RECT);
+	return (struct wlr_scene_rect *)node;
+}
+
+static struct wlr_scene *scene_node_get_root(struct wlr_scene_node *node) {
+	while (node->parent != NULL) {
+		node = node->parent;
+	}
+	return scene_root_from_node(node);
+}
+
+static void scene_node_state_init(struct wlr_scene_node_state *state) {
+	wl_list_init(&state->children);
+	wl_list_init(&state->link);
+	state->enabled = true;
+}
+
+static void scene_node_state_finish(struct wlr_scene_node_state *state) {
+	wl_list_remove(&state->link);
+}
+
+static void scene_node_init(struct wlr_scene_node *node,
+		enum wlr_scene_node_type type, struct wlr_scene_node *parent) {
+	assert(type == WLR_SCENE_NODE_ROOT || parent != NULL);
+
+	node->type = type;
+	node->parent = parent;
+	scene_node_state_init(&node->state);
+	wl_signal_init(&node->events.destroy);
+
+	if (parent != NULL) {
+		wl_list_insert(parent->state.children.prev, &node->state.link);
+	}
+}
+
+static void scene_node_get_size(struct wlr_scene_node *node,
+		int *width, int *height) {
+	*width = 0;
+	*height = 0;
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		return;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		*width = scene_surface->surface->current.width;
+		*height = scene_surface->surface->current.height;
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		*width = scene_rect->width;
+		*height = scene_rect->height;
+		break;
+	}
+}
+
+typedef void (*scene_node_iterator_func_t)(struct wlr_scene_node *node,
+	int x, int y, void *data);
+
+/**
+ * Call `iterator` on each enabled node of the sub-tree in rendering order.
+ * (lx, ly) is the position of the node's parent.
+ */
+static void scene_node_for_each_node(struct wlr_scene_node *node,
+		int lx, int ly, scene_node_iterator_func_t iterator,
+		void *user_data) {
+	if (!node->state.enabled) {
+		return;
+	}
+
+	lx += node->state.x;
+	ly += node->state.y;
+
+	iterator(node, lx, ly, user_data);
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		scene_node_for_each_node(child, lx, ly, iterator, user_data);
+	}
+}
+
+static void scale_box(struct wlr_box *box, float scale) {
+	box->width = round((box->x + box->width) * scale) - round(box->x * scale);
+	box->height = round((box->y + box->height) * scale) - round(box->y * scale);
+	box->x = round(box->x * scale);
+	box->y = round(box->y * scale);
+}
+
+/**
+ * Add damage to an output, in scene-graph coordinates.
+ */
+static void scene_output_damage(struct wlr_scene_output *scene_output,
+		pixman_region32_t *damage) {
+	struct wlr_output *output = scene_output->output;
+
+	int width, height;
+	wlr_output_transformed_resolution(output, &width, &height);
+
+	pixman_region32_t output_damage;
+	pixman_region32_init(&output_damage);
+	pixman_region32_copy(&output_damage, damage);
+	pixman_region32_translate(&output_damage,
+		-scene_output->x, -scene_output->y);
+	wlr_region_scale(&output_damage, &output_damage, output->scale);
+	pixman_region32_intersect_rect(&output_damage, &output_damage,
+		0, 0, width, height);
+	// Don't schedule a frame for damage outside of the output
+	if (pixman_region32_not_empty(&output_damage)) {
+		wlr_output_damage_add(scene_output->damage, &output_damage);
+	}
+	pixman_region32_fini(&output_damage);
+}
+
+static void damage_whole_iterator(struct wlr_scene_node *node,
+		int lx, int ly, void *data) {
+	struct wlr_scene *scene = data;
+
+	int width, height;
+	scene_node_get_size(node, &width, &height);
+	if (width <= 0 || height <= 0) {
+		return;
+	}
+
+	pixman_region32_t damage;
+	pixman_region32_init_rect(&damage, lx, ly, width, height);
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		scene_output_damage(scene_output, &damage);
+	}
+	pixman_region32_fini(&damage);
+}
+
+static void scene_node_damage_whole(struct wlr_scene_node *node) {
+	struct wlr_scene *scene = scene_node_get_root(node);
+	if (wl_list_empty(&scene->outputs)) {
+		return;
+	}
+
+	int lx, ly;
+	if (!wlr_scene_node_coords(node, &lx, &ly)) {
+		return;
+	}
+
+	scene_node_for_each_node(node, lx - node->state.x, ly - node->state.y,
+		damage_whole_iterator, scene);
+}
+
+static void scene_node_destroy(struct wlr_scene_node *node) {
+	wlr_signal_emit_safe(&node->events.destroy, NULL);
+
+	struct wlr_scene_node *child, *child_tmp;
+	wl_list_for_each_safe(child, child_tmp,
+			&node->state.children, state.link) {
+		scene_node_destroy(child);
+	}
+
+	scene_node_state_finish(&node->state);
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:;
+		struct wlr_scene *scene = scene_root_from_node(node);
+		struct wlr_scene_output *scene_output, *scene_output_tmp;
+		wl_list_for_each_safe(scene_output, scene_output_tmp,
+				&scene->outputs, link) {
+			wlr_scene_output_destroy(scene_output);
+		}
+		free(scene);
+		break;
+	case WLR_SCENE_NODE_TREE:;
+		struct wlr_scene_tree *tree = scene_tree_from_node(node);
+		free(tree);
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		wl_list_remove(&scene_surface->surface_destroy.link);
+		wl_list_remove(&scene_surface->surface_commit.link);
+		free(scene_surface);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		free(scene_rect);
+		break;
+	}
+}
+
+void wlr_scene_node_destroy(struct wlr_scene_node *node) {
+	if (node == NULL) {
+		return;
+	}
+
+	// The outputs of a scene being destroyed don't need to be re-drawn
+	if (node->type != WLR_SCENE_NODE_ROOT) {
+		scene_node_damage_whole(node);
+	}
+	scene_node_destroy(node);
+}
+
+struct wlr_scene *wlr_scene_create(void) {
+	struct wlr_scene *scene = calloc(1, sizeof(struct wlr_scene));
+	if (scene == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene->node, WLR_SCENE_NODE_ROOT, NULL);
+	wl_list_init(&scene->outputs);
+	scene->hidden_frame_done_interval = HIDDEN_FRAME_DONE_INTERVAL;
+	return scene;
+}
+
+struct wlr_scene_tree *wlr_scene_tree_create(struct wlr_scene_node *parent) {
+	struct wlr_scene_tree *tree =
+		calloc(1, sizeof(struct wlr_scene_tree));
+	if (tree == NULL) {
+		return NULL;
+	}
+	scene_node_init(&tree->node, WLR_SCENE_NODE_TREE, parent);
+	return tree;
+}
+
+static void scene_surface_handle_surface_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_destroy);
+	wlr_scene_node_destroy(&scene_surface->node);
+}
+
+static void scene_surface_handle_surface_commit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_surface *scene_surface =
+		wl_container_of(listener, scene_surface, surface_commit);
+	struct wlr_surface *surface = scene_surface->surface;
+
+	struct wlr_scene *scene = scene_node_get_root(&scene_surface->node);
+	if (wl_list_empty(&scene->outputs)) {
+		return;
+	}
+
+	int lx, ly;
+	if (!wlr_scene_node_coords(&scene_surface->node, &lx, &ly)) {
+		return;
+	}
+
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_surface_get_effective_damage(surface, &damage);
+	pixman_region32_translate(&damage, lx, ly);
+
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		scene_output_damage(scene_output, &damage);
+	}
+
+	pixman_region32_fini(&damage);
+}
+
+struct wlr_scene_surface *wlr_scene_surface_create(struct wlr_scene_node *parent,
+		struct wlr_surface *surface) {
+	struct wlr_scene_surface *scene_surface =
+		calloc(1, sizeof(struct wlr_scene_surface));
+	if (scene_surface == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene_surface->node, WLR_SCENE_NODE_SURFACE, parent);
+
+	scene_surface->surface = surface;
+
+	scene_surface->surface_destroy.notify =
+		scene_surface_handle_surface_destroy;
+	wl_signal_add(&surface->events.destroy, &scene_surface->surface_destroy);
+
+	scene_surface->surface_commit.notify = scene_surface_handle_surface_commit;
+	wl_signal_add(&surface->events.commit, &scene_surface->surface_commit);
+
+	scene_node_damage_whole(&scene_surface->node);
+
+	return scene_surface;
+}
+
+struct wlr_scene_rect *wlr_scene_rect_create(struct wlr_scene_node *parent,
+		int width, int height, const float color[static 4]) {
+	struct wlr_scene_rect *scene_rect =
+		calloc(1, sizeof(struct wlr_scene_rect));
+	if (scene_rect == NULL) {
+		return NULL;
+	}
+	scene_node_init(&scene_rect->node, WLR_SCENE_NODE_RECT, parent);
+
+	scene_rect->width = width;
+	scene_rect->height = height;
+	memcpy(scene_rect->color, color, sizeof(scene_rect->color));
+
+	scene_node_damage_whole(&scene_rect->node);
+
+	return scene_rect;
+}
+
+void wlr_scene_rect_set_size(struct wlr_scene_rect *rect, int width,
+		int height) {
+	if (rect->width == width && rect->height == height) {
+		return;
+	}
+
+	scene_node_damage_whole(&rect->node);
+	rect->width = width;
+	rect->height = height;
+	scene_node_damage_whole(&rect->node);
+}
+
+void wlr_scene_rect_set_color(struct wlr_scene_rect *rect,
+		const float color[static 4]) {
+	if (memcmp(rect->color, color, sizeof(rect->color)) == 0) {
+		return;
+	}
+
+	memcpy(rect->color, color, sizeof(rect->color));
+	scene_node_damage_whole(&rect->node);
+}
+
+void wlr_scene_node_set_enabled(struct wlr_scene_node *node, bool enabled) {
+	if (node->state.enabled == enabled) {
+		return;
+	}
+
+	// One of these damage_whole() calls will short-circuit and be a no-op
+	scene_node_damage_whole(node);
+	node->state.enabled = enabled;
+	scene_node_damage_whole(node);
+}
+
+void wlr_scene_node_set_position(struct wlr_scene_node *node, int x, int y) {
+	if (node->state.x == x && node->state.y == y) {
+		return;
+	}
+
+	scene_node_damage_whole(node);
+	node->state.x = x;
+	node->state.y = y;
+	scene_node_damage_whole(node);
+}
+
+void wlr_scene_node_place_above(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node != sibling);
+	assert(node->parent == sibling->parent);
+
+	if (node->state.link.prev == &sibling->state.link) {
+		return;
+	}
+
+	wl_list_remove(&node->state.link);
+	wl_list_insert(&sibling->state.link, &node->state.link);
+
+	scene_node_damage_whole(node);
+	scene_node_damage_whole(sibling);
+}
+
+void wlr_scene_node_place_below(struct wlr_scene_node *node,
+		struct wlr_scene_node *sibling) {
+	assert(node != sibling);
+	assert(node->parent == sibling->parent);
+
+	if (node->state.link.next == &sibling->state.link) {
+		return;
+	}
+
+	wl_list_remove(&node->state.link);
+	wl_list_insert(sibling->state.link.prev, &node->state.link);
+
+	scene_node_damage_whole(node);
+	scene_node_damage_whole(sibling);
+}
+
+void wlr_scene_node_raise_to_top(struct wlr_scene_node *node) {
+	struct wlr_scene_node *current_top = wl_container_of(
+		node->parent->state.children.prev, current_top, state.link);
+	if (node == current_top) {
+		return;
+	}
+	wlr_scene_node_place_above(node, current_top);
+}
+
+void wlr_scene_node_lower_to_bottom(struct wlr_scene_node *node) {
+	struct wlr_scene_node *current_bottom = wl_container_of(
+		node->parent->state.children.next, current_bottom, state.link);
+	if (node == current_bottom) {
+		return;
+	}
+	wlr_scene_node_place_below(node, current_bottom);
+}
+
+void wlr_scene_node_reparent(struct wlr_scene_node *node,
+		struct wlr_scene_node *new_parent) {
+	assert(node->type != WLR_SCENE_NODE_ROOT && new_parent != NULL);
+
+	if (node->parent == new_parent) {
+		return;
+	}
+
+	// Ensure that a node cannot become its own ancestor
+	for (struct wlr_scene_node *ancestor = new_parent; ancestor != NULL;
+			ancestor = ancestor->parent) {
+		assert(ancestor != node);
+	}
+
+	scene_node_damage_whole(node);
+
+	wl_list_remove(&node->state.link);
+	node->parent = new_parent;
+	wl_list_insert(new_parent->state.children.prev, &node->state.link);
+
+	scene_node_damage_whole(node);
+}
+
+bool wlr_scene_node_coords(struct wlr_scene_node *node,
+		int *lx_ptr, int *ly_ptr) {
+	int lx = 0, ly = 0;
+	bool enabled = true;
+	while (node != NULL) {
+		lx += node->state.x;
+		ly += node->state.y;
+		enabled = enabled && node->state.enabled;
+		node = node->parent;
+	}
+
+	*lx_ptr = lx;
+	*ly_ptr = ly;
+	return enabled;
+}
+
+struct surface_iterator_data {
+	wlr_surface_iterator_func_t user_iterator;
+	void *user_data;
+};
+
+static void surface_iterator(struct wlr_scene_node *node,
+		int lx, int ly, void *_data) {
+	struct surface_iterator_data *data = _data;
+	if (node->type != WLR_SCENE_NODE_SURFACE) {
+		return;
+	}
+	struct wlr_scene_surface *scene_surface = wlr_scene_surface_from_node(node);
+	data->user_iterator(scene_surface->surface, lx, ly, data->user_data);
+}
+
+void wlr_scene_node_for_each_surface(struct wlr_scene_node *node,
+		wlr_surface_iterator_func_t user_iterator, void *user_data) {
+	struct surface_iterator_data data = {
+		.user_iterator = user_iterator,
+		.user_data = user_data,
+	};
+
+	int lx, ly;
+	wlr_scene_node_coords(node, &lx, &ly);
+	scene_node_for_each_node(node, lx - node->state.x, ly - node->state.y,
+		surface_iterator, &data);
+}
+
+struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene_node *node,
+		double lx, double ly, double *nx, double *ny) {
+	if (!node->state.enabled) {
+		return NULL;
+	}
+
+	lx -= node->state.x;
+	ly -= node->state.y;
+
+	struct wlr_scene_node *child;
+	wl_list_for_each_reverse(child, &node->state.children, state.link) {
+		struct wlr_scene_node *found =
+			wlr_scene_node_at(child, lx, ly, nx, ny);
+		if (found != NULL) {
+			return found;
+		}
+	}
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		if (wlr_surface_point_accepts_input(scene_surface->surface, lx, ly)) {
+			goto found;
+		}
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *rect = scene_rect_from_node(node);
+		if (lx >= 0 && lx < rect->width && ly >= 0 && ly < rect->height) {
+			goto found;
+		}
+		break;
+	}
+
+	return NULL;
+
+found:
+	if (nx != NULL) {
+		*nx = lx;
+	}
+	if (ny != NULL) {
+		*ny = ly;
+	}
+	return node;
+}
+
+/**
+ * Get the scissor box of an output-local damage rectangle.
+ */
+static void get_scissor_box(struct wlr_output *output,
+		const pixman_box32_t *rect, struct wlr_box *box) {
+	*box = (struct wlr_box){
+		.x = rect->x1,
+		.y = rect->y1,
+		.width = rect->x2 - rect->x1,
+		.height = rect->y2 - rect->y1,
+	};
+
+	int ow, oh;
+	wlr_output_transformed_resolution(output, &ow, &oh);
+
+	enum wl_output_transform transform =
+		wlr_output_transform_invert(output->transform);
+	wlr_box_transform(box, box, transform, ow, oh);
+}
+
+static void render_rect(struct wlr_output *output,
+		pixman_region32_t *output_damage, const float color[static 4],
+		const struct wlr_box *box) {
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	assert(renderer);
+
+	pixman_region32_t damage;
+	pixman_region32_init_rect(&damage, box->x, box->y,
+		box->width, box->height);
+	pixman_region32_intersect(&damage, &damage, output_damage);
+
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		struct wlr_box scissor_box;
+		get_scissor_box(output, &rects[i], &scissor_box);
+		wlr_renderer_scissor(renderer, &scissor_box);
+		wlr_render_rect(renderer, box, color, output->transform_matrix);
+	}
+	wlr_renderer_scissor(renderer, NULL);
+
+	pixman_region32_fini(&damage);
+}
+
+static void render_texture(struct wlr_output *output,
+		pixman_region32_t *output_damage, struct wlr_texture *texture,
+		const struct wlr_fbox *src_box, const struct wlr_box *box,
+		const float matrix[static 9]) {
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	assert(renderer);
+
+	pixman_region32_t damage;
+	pixman_region32_init_rect(&damage, box->x, box->y,
+		box->width, box->height);
+	pixman_region32_intersect(&damage, &damage, output_damage);
+
+	// Queue the texture once per damaged rectangle, the renderer merges
+	// these into as few draw calls as possible
+	int nrects;
+	pixman_box32_t *rects = pixman_region32_rectangles(&damage, &nrects);
+	for (int i = 0; i < nrects; ++i) {
+		struct wlr_box clip;
+		get_scissor_box(output, &rects[i], &clip);
+		wlr_render_batch_add(renderer, texture, src_box, matrix, 1.0, &clip);
+	}
+
+	pixman_region32_fini(&damage);
+}
+
+/**
+ * A node to be rendered, along with the part of the output damage which it
+ * needs to re-draw once the nodes above it have been taken into account.
+ */
+struct render_entry {
+	struct wlr_scene_node *node;
+	int x, y; // output-local
+	pixman_region32_t damage; // output-local, scaled
+};
+
+static bool scene_node_is_visible(struct wlr_scene_node *node) {
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		return false;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		return wlr_surface_get_texture(scene_surface->surface) != NULL;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		return scene_rect->color[3] > 0;
+	}
+	return false;
+}
+
+/**
+ * Scale a region so that the result only contains pixels fully covered by the
+ * source region. This is the opposite of wlr_region_scale, which rounds
+ * outwards.
+ */
+static void scale_region_inward(pixman_region32_t *region, float scale) {
+	if (scale == 1.0) {
+		return;
+	}
+
+	int nrects;
+	pixman_box32_t *src_rects = pixman_region32_rectangles(region, &nrects);
+	pixman_box32_t *dst_rects = calloc(nrects, sizeof(pixman_box32_t));
+	if (dst_rects == NULL) {
+		pixman_region32_clear(region);
+		return;
+	}
+
+	int dst_nrects = 0;
+	for (int i = 0; i < nrects; ++i) {
+		pixman_box32_t box = {
+			.x1 = ceil(src_rects[i].x1 * scale),
+			.y1 = ceil(src_rects[i].y1 * scale),
+			.x2 = floor(src_rects[i].x2 * scale),
+			.y2 = floor(src_rects[i].y2 * scale),
+		};
+		if (box.x1 < box.x2 && box.y1 < box.y2) {
+			dst_rects[dst_nrects++] = box;
+		}
+	}
+
+	pixman_region32_fini(region);
+	pixman_region32_init_rects(region, dst_rects, dst_nrects);
+	free(dst_rects);
+}
+
+/**
+ * Get the region of the output fully covered by a node, in output-local scaled
+ * coordinates.
+ */
+static void scene_node_get_opaque_region(struct wlr_scene_node *node,
+		int x, int y, float scale, pixman_region32_t *opaque) {
+	pixman_region32_clear(opaque);
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		return;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		pixman_region32_copy(opaque, &scene_surface->surface->opaque_region);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+		if (scene_rect->color[3] == 1.0) {
+			pixman_region32_union_rect(opaque, opaque, 0, 0,
+				scene_rect->width, scene_rect->height);
+		}
+		break;
+	}
+
+	pixman_region32_translate(opaque, x, y);
+	scale_region_inward(opaque, scale);
+}
+
+static void render_list_iterator(struct wlr_scene_node *node,
+		int x, int y, void *data) {
+	struct wl_array *render_list = data;
+	if (!scene_node_is_visible(node)) {
+		return;
+	}
+
+	struct render_entry *entry = wl_array_add(render_list, sizeof(*entry));
+	if (entry == NULL) {
+		return;
+	}
+	entry->node = node;
+	entry->x = x;
+	entry->y = y;
+}
+
+static void render_node(struct wlr_scene_node *node, int x, int y,
+		struct wlr_output *output, pixman_region32_t *output_damage) {
+	struct wlr_box dst_box = {
+		.x = x,
+		.y = y,
+	};
+	scene_node_get_size(node, &dst_box.width, &dst_box.height);
+	scale_box(&dst_box, output->scale);
+
+	switch (node->type) {
+	case WLR_SCENE_NODE_ROOT:
+	case WLR_SCENE_NODE_TREE:
+		/* Root or tree node has nothing to render itself */
+		break;
+	case WLR_SCENE_NODE_SURFACE:;
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		struct wlr_surface *surface = scene_surface->surface;
+
+		struct wlr_texture *texture = wlr_surface_get_texture(surface);
+		if (texture == NULL) {
+			return;
+		}
+
+		struct wlr_fbox src_box;
+		wlr_surface_get_buffer_source_box(surface, &src_box);
+
+		float matrix[9];
+		enum wl_output_transform transform =
+			wlr_output_transform_invert(surface->current.transform);
+		wlr_matrix_project_box(matrix, &dst_box, transform, 0.0,
+			output->transform_matrix);
+
+		render_texture(output, output_damage, texture, &src_box, &dst_box,
+			matrix);
+		break;
+	case WLR_SCENE_NODE_RECT:;
+		struct wlr_scene_rect *scene_rect = scene_rect_from_node(node);
+
+		render_rect(output, output_damage, scene_rect->color, &dst_box);
+		break;
+	}
+}
+
+static void scene_render_output(struct wlr_scene *scene,
+		struct wlr_output *output, int lx, int ly, pixman_region32_t *damage,
+		const float *clear_color) {
+	if (!output->enabled || !pixman_region32_not_empty(damage)) {
+		return;
+	}
+
+	struct wl_array render_list;
+	wl_array_init(&render_list);
+	scene_node_for_each_node(&scene->node, -lx, -ly,
+		render_list_iterator, &render_list);
+
+	// Walk the nodes from top to bottom, and only keep the damage which isn't
+	// covered by the opaque regions of the nodes above. Fully occluded nodes
+	// end up with an empty damage region and are skipped.
+	pixman_region32_t remaining, opaque;
+	pixman_region32_init(&remaining);
+	pixman_region32_init(&opaque);
+	pixman_region32_copy(&remaining, damage);
+
+	struct render_entry *entries = render_list.data;
+	size_t entries_len = render_list.size / sizeof(*entries);
+	for (size_t i = entries_len; i-- > 0;) {
+		struct render_entry *entry = &entries[i];
+
+		struct wlr_box box = { .x = entry->x, .y = entry->y };
+		scene_node_get_size(entry->node, &box.width, &box.height);
+		scale_box(&box, output->scale);
+
+		pixman_region32_init_rect(&entry->damage, box.x, box.y,
+			box.width, box.height);
+		pixman_region32_intersect(&entry->damage, &entry->damage, &remaining);
+
+		scene_node_get_opaque_region(entry->node, entry->x, entry->y,
+			output->scale, &opaque);
+		pixman_region32_subtract(&remaining, &remaining, &opaque);
+	}
+
+	if (clear_color != NULL) {
+		// Only the parts of the output not covered by opaque nodes need to be
+		// cleared
+		struct wlr_renderer *renderer =
+			wlr_backend_get_renderer(output->backend);
+		assert(renderer);
+
+		int nrects;
+		pixman_box32_t *rects = pixman_region32_rectangles(&remaining, &nrects);
+		for (int i = 0; i < nrects; ++i) {
+			struct wlr_box scissor_box;
+			get_scissor_box(output, &rects[i], &scissor_box);
+			wlr_renderer_scissor(renderer, &scissor_box);
+			wlr_renderer_clear(renderer, clear_color);
+		}
+		wlr_renderer_scissor(renderer, NULL);
+	}
+
+	for (size_t i = 0; i < entries_len; i++) {
+		struct render_entry *entry = &entries[i];
+		if (pixman_region32_not_empty(&entry->damage)) {
+			render_node(entry->node, entry->x, entry->y, output,
+				&entry->damage);
+		}
+		pixman_region32_fini(&entry->damage);
+	}
+
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&remaining);
+	wl_array_release(&render_list);
+}
+
+void wlr_scene_render_output(struct wlr_scene *scene, struct wlr_output *output,
+		int lx, int ly, pixman_region32_t *damage) {
+	pixman_region32_t full_region;
+	pixman_region32_init(&full_region);
+	if (damage == NULL) {
+		int width, height;
+		wlr_output_transformed_resolution(output, &width, &height);
+		pixman_region32_union_rect(&full_region, &full_region,
+			0, 0, width, height);
+		damage = &full_region;
+	}
+
+	scene_render_output(scene, output, lx, ly, damage, NULL);
+
+	pixman_region32_fini(&full_region);
+}
+
+static void scene_output_handle_damage_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_scene_output *scene_output =
+		wl_container_of(listener, scene_output, damage_destroy);
+	// The output damage is destroyed along with the output
+	scene_output->damage = NULL;
+	wl_list_remove(&scene_output->damage_destroy.link);
+	wl_list_init(&scene_output->damage_destroy.link);
+	wlr_scene_output_destroy(scene_output);
+}
+
+struct wlr_scene_output *wlr_scene_output_create(struct wlr_scene *scene,
+		struct wlr_output *output) {
+	assert(wlr_scene_get_scene_output(scene, output) == NULL);
+
+	struct wlr_scene_output *scene_output =
+		calloc(1, sizeof(struct wlr_scene_output));
+	if (scene_output == NULL) {
+		return NULL;
+	}
+
+	scene_output->damage = wlr_output_damage_create(output);
+	if (scene_output->damage == NULL) {
+		free(scene_output);
+		return NULL;
+	}
+
+	scene_output->output = output;
+	scene_output->scene = scene;
+	wl_list_insert(&scene->outputs, &scene_output->link);
+
+	scene_output->damage_destroy.notify = scene_output_handle_damage_destroy;
+	wl_signal_add(&scene_output->damage->events.destroy,
+		&scene_output->damage_destroy);
+
+	wlr_output_damage_add_whole(scene_output->damage);
+
+	return scene_output;
+}
+
+void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
+	if (scene_output == NULL) {
+		return;
+	}
+	wl_list_remove(&scene_output->link);
+	wl_list_remove(&scene_output->damage_destroy.link);
+	wlr_output_damage_destroy(scene_output->damage);
+	free(scene_output);
+}
+
+struct wlr_scene_output *wlr_scene_get_scene_output(struct wlr_scene *scene,
+		struct wlr_output *output) {
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		if (scene_output->output == output) {
+			return scene_output;
+		}
+	}
+	return NULL;
+}
+
+void wlr_scene_output_set_position(struct wlr_scene_output *scene_output,
+		int lx, int ly) {
+	if (scene_output->x == lx && scene_output->y == ly) {
+		return;
+	}
+
+	scene_output->x = lx;
+	scene_output->y = ly;
+	wlr_output_damage_add_whole(scene_output->damage);
+}
+
+bool wlr_scene_output_commit(struct wlr_scene_output *scene_output) {
+	struct wlr_output *output = scene_output->output;
+
+	struct wlr_renderer *renderer = wlr_backend_get_renderer(output->backend);
+	assert(renderer != NULL);
+
+	bool needs_frame;
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	if (!wlr_output_damage_attach_render(scene_output->damage,
+			&needs_frame, &damage)) {
+		pixman_region32_fini(&damage);
+		return false;
+	}
+
+	if (!needs_frame) {
+		pixman_region32_fini(&damage);
+		wlr_output_rollback(output);
+		return true;
+	}
+
+	wlr_renderer_begin(renderer, output->width, output->height);
+
+	const float clear_color[4] = { 0.0, 0.0, 0.0, 1.0 };
+	scene_render_output(scene_output->scene, output,
+		scene_output->x, scene_output->y, &damage, clear_color);
+	wlr_output_render_software_cursors(output, &damage);
+
+	wlr_renderer_end(renderer);
+	pixman_region32_fini(&damage);
+
+	int tr_width, tr_height;
+	wlr_output_transformed_resolution(output, &tr_width, &tr_height);
+
+	enum wl_output_transform transform =
+		wlr_output_transform_invert(output->transform);
+
+	pixman_region32_t frame_damage;
+	pixman_region32_init(&frame_damage);
+	wlr_region_transform(&frame_damage, &scene_output->damage->current,
+		transform, tr_width, tr_height);
+	wlr_output_set_damage(output, &frame_damage);
+	pixman_region32_fini(&frame_damage);
+
+	return wlr_output_commit(output);
+}
+
+static void scene_surface_send_frame_done(
+		struct wlr_scene_surface *scene_surface, struct timespec *now) {
+	wlr_surface_send_frame_done(scene_surface->surface, now);
+	scene_surface->last_frame_done = *now;
+}
+
+/**
+ * Send frame done events to the surfaces of the sub-tree which haven't
+ * received one for `interval` milliseconds, including disabled ones.
+ */
+static void scene_node_send_hidden_frame_done(struct wlr_scene_node *node,
+		struct timespec *now, int interval) {
+	if (node->type == WLR_SCENE_NODE_SURFACE) {
+		struct wlr_scene_surface *scene_surface =
+			wlr_scene_surface_from_node(node);
+		struct timespec elapsed;
+		timespec_sub(&elapsed, now, &scene_surface->last_frame_done);
+		if (timespec_to_msec(&elapsed) >= interval) {
+			scene_surface_send_frame_done(scene_surface, now);
+		}
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &node->state.children, state.link) {
+		scene_node_send_hidden_frame_done(child, now, interval);
+	}
+}
+
+void wlr_scene_output_send_frame_done(struct wlr_scene_output *scene_output,
+		struct timespec *now) {
+	struct wlr_scene *scene = scene_output->scene;
+	struct wlr_output *output = scene_output->output;
+
+	struct wl_array render_list;
+	wl_array_init(&render_list);
+	scene_node_for_each_node(&scene->node, -scene_output->x, -scene_output->y,
+		render_list_iterator, &render_list);
+
+	// Same as rendering: walk the nodes from top to bottom, a surface is
+	// visible if it isn't covered by the opaque regions of the nodes above
+	int width, height;
+	wlr_output_transformed_resolution(output, &width, &height);
+
+	pixman_region32_t remaining, opaque;
+	pixman_region32_init_rect(&remaining, 0, 0, width, height);
+	pixman_region32_init(&opaque);
+
+	struct render_entry *entries = render_list.data;
+	size_t entries_len = render_list.size / sizeof(*entries);
+	for (size_t i = entries_len; i-- > 0;) {
+		struct render_entry *entry = &entries[i];
+
+		if (entry->node->type == WLR_SCENE_NODE_SURFACE) {
+			struct wlr_box box = { .x = entry->x, .y = entry->y };
+			scene_node_get_size(entry->node, &box.width, &box.height);
+			scale_box(&box, output->scale);
+
+			pixman_region32_t visible;
+			pixman_region32_init_rect(&visible, box.x, box.y,
+				box.width, box.height);
+			pixman_region32_intersect(&visible, &visible, &remaining);
+			if (pixman_region32_not_empty(&visible)) {
+				scene_surface_send_frame_done(
+					wlr_scene_surface_from_node(entry->node), now);
+			}
+			pixman_region32_fini(&visible);
+		}
+
+		scene_node_get_opaque_region(entry->node, entry->x, entry->y,
+			output->scale, &opaque);
+		pixman_region32_subtract(&remaining, &remaining, &opaque);
+	}
+
+	pixman_region32_fini(&opaque);
+	pixman_region32_fini(&remaining);
+	wl_array_release(&render_list);
+
+	// Surfaces visible on other outputs have received a frame done event
+	// recently, so they aren't affected
+	scene_node_send_hidden_frame_done(&scene->node, now,
+		scene->hidden_frame_done_interval);
+}
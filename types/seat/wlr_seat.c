@@ -95,6 +95,8 @@ static void seat_client_handle_resource_destroy(
 		wl_list_init(link);
 	}
 
+	wl_list_remove(&client->bucket_link);
+	client->seat->clients_len--;
 	wl_list_remove(&client->link);
 	free(client);
 }
@@ -111,6 +113,36 @@ static const struct wl_seat_interface seat_impl = {
 	.release = seat_handle_release,
 };
 
+static struct wl_list *seat_get_client_bucket(struct wlr_seat *seat,
+		struct wl_client *client) {
+	// Fibonacci hashing of the pointer, the bucket count is a power of two
+	uint64_t hash = (uint64_t)(uintptr_t)client * UINT64_C(11400714819323198485);
+	return &seat->client_buckets[(hash >> 32) & (seat->client_buckets_len - 1)];
+}
+
+static bool seat_grow_client_buckets(struct wlr_seat *seat) {
+	size_t len = seat->client_buckets_len > 0 ?
+		2 * seat->client_buckets_len : 16;
+	struct wl_list *buckets = calloc(len, sizeof(struct wl_list));
+	if (buckets == NULL) {
+		return false;
+	}
+	for (size_t i = 0; i < len; i++) {
+		wl_list_init(&buckets[i]);
+	}
+
+	free(seat->client_buckets);
+	seat->client_buckets = buckets;
+	seat->client_buckets_len = len;
+
+	struct wlr_seat_client *seat_client;
+	wl_list_for_each(seat_client, &seat->clients, link) {
+		wl_list_insert(seat_get_client_bucket(seat, seat_client->client),
+			&seat_client->bucket_link);
+	}
+	return true;
+}
+
 static void seat_handle_bind(struct wl_client *client, void *_wlr_seat,
 		uint32_t version, uint32_t id) {
 	struct wlr_seat *wlr_seat = _wlr_seat;
@@ -126,6 +158,13 @@ static void seat_handle_bind(struct wl_client *client, void *_wlr_seat,
 	struct wlr_seat_client *seat_client =
 		wlr_seat_client_for_wl_client(wlr_seat, client);
 	if (seat_client == NULL) {
+		if (wlr_seat->clients_len >= wlr_seat->client_buckets_len &&
+				!seat_grow_client_buckets(wlr_seat)) {
+			wl_resource_destroy(wl_resource);
+			wl_client_post_no_memory(client);
+			return;
+		}
+
 		seat_client = calloc(1, sizeof(struct wlr_seat_client));
 		if (seat_client == NULL) {
 			wl_resource_destroy(wl_resource);
@@ -143,6 +182,9 @@ static void seat_handle_bind(struct wl_client *client, void *_wlr_seat,
 		wl_signal_init(&seat_client->events.destroy);
 
 		wl_list_insert(&wlr_seat->clients, &seat_client->link);
+		wl_list_insert(seat_get_client_bucket(wlr_seat, client),
+			&seat_client->bucket_link);
+		wlr_seat->clients_len++;
 	}
 
 	wl_resource_set_implementation(wl_resource, &seat_impl,
@@ -192,6 +234,7 @@ void wlr_seat_destroy(struct wlr_seat *seat) {
 	}
 
 	wlr_global_destroy_safe(seat->global, seat->display);
+	free(seat->client_buckets);
 	free(seat->pointer_state.default_grab);
 	free(seat->keyboard_state.default_grab);
 	free(seat->touch_state.default_grab);
@@ -307,8 +350,12 @@ struct wlr_seat *wlr_seat_create(struct wl_display *display, const char *name) {
 
 struct wlr_seat_client *wlr_seat_client_for_wl_client(struct wlr_seat *wlr_seat,
 		struct wl_client *wl_client) {
+	if (wlr_seat->client_buckets_len == 0) {
+		return NULL;
+	}
 	struct wlr_seat_client *seat_client;
-	wl_list_for_each(seat_client, &wlr_seat->clients, link) {
+	wl_list_for_each(seat_client,
+			seat_get_client_bucket(wlr_seat, wl_client), bucket_link) {
 		if (seat_client->client == wl_client) {
 			return seat_client;
 		}
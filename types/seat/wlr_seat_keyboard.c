@@ -87,6 +87,11 @@ void wlr_seat_keyboard_send_key(struct wlr_seat *wlr_seat, uint32_t time,
 	}
 }
 
+// Since this version, clients must map the keymap with MAP_PRIVATE. Older
+// clients may map it with MAP_SHARED, which sealed files don't support on
+// some systems.
+#define KEYMAP_MAP_PRIVATE_SINCE_VERSION 7
+
 static void seat_client_send_keymap(struct wlr_seat_client *client,
 	struct wlr_keyboard *keyboard);
 
@@ -364,6 +369,15 @@ static void seat_client_send_keymap(struct wlr_seat_client *client,
 			continue;
 		}
 
+		if (keyboard->keymap_fd >= 0 && wl_resource_get_version(resource) >=
+				KEYMAP_MAP_PRIVATE_SINCE_VERSION) {
+			// The sealed file can't be altered by clients, share it
+			wl_keyboard_send_keymap(resource,
+				WL_KEYBOARD_KEYMAP_FORMAT_XKB_V1, keyboard->keymap_fd,
+				keyboard->keymap_size);
+			continue;
+		}
+
 		int keymap_fd = allocate_shm_file(keyboard->keymap_size);
 		if (keymap_fd < 0) {
 			wlr_log(WLR_ERROR, "creating a keymap file for %zu bytes failed", keyboard->keymap_size);
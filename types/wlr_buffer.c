@@ -1,15 +1,22 @@
 #include <assert.h>
 #include <stdlib.h>
+#include <wlr/render/interface.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_buffer.h>
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/util/log.h>
+#include <wlr/util/region.h>
 #include "render/pixel_format.h"
+#include "types/wlr_buffer.h"
+#include "types/wlr_linux_dmabuf_v1.h"
 #include "util/signal.h"
 
 void wlr_buffer_init(struct wlr_buffer *buffer,
 		const struct wlr_buffer_impl *impl, int width, int height) {
 	assert(impl->destroy);
+	if (impl->begin_data_ptr_access || impl->end_data_ptr_access) {
+		assert(impl->begin_data_ptr_access && impl->end_data_ptr_access);
+	}
 	buffer->impl = impl;
 	buffer->width = width;
 	buffer->height = height;
@@ -65,6 +72,32 @@ bool wlr_buffer_get_dmabuf(struct wlr_buffer *buffer,
 	return buffer->impl->get_dmabuf(buffer, attribs);
 }
 
+bool wlr_buffer_get_shm(struct wlr_buffer *buffer,
+		struct wlr_shm_attributes *attribs) {
+	if (!buffer->impl->get_shm) {
+		return false;
+	}
+	return buffer->impl->get_shm(buffer, attribs);
+}
+
+bool buffer_begin_data_ptr_access(struct wlr_buffer *buffer, void **data,
+		uint32_t *format, size_t *stride) {
+	assert(!buffer->accessing_data_ptr);
+	if (!buffer->impl->begin_data_ptr_access) {
+		return false;
+	}
+	if (!buffer->impl->begin_data_ptr_access(buffer, data, format, stride)) {
+		return false;
+	}
+	buffer->accessing_data_ptr = true;
+	return true;
+}
+
+void buffer_end_data_ptr_access(struct wlr_buffer *buffer) {
+	assert(buffer->accessing_data_ptr);
+	buffer->impl->end_data_ptr_access(buffer);
+	buffer->accessing_data_ptr = false;
+}
 
 bool wlr_resource_is_buffer(struct wl_resource *resource) {
 	return strcmp(wl_resource_get_class(resource), wl_buffer_interface.name) == 0;
@@ -95,6 +128,100 @@ bool wlr_resource_get_buffer_size(struct wl_resource *resource,
 	return true;
 }
 
+static const struct wlr_buffer_impl shm_client_buffer_impl;
+
+static struct wlr_shm_client_buffer *shm_client_buffer_from_buffer(
+		struct wlr_buffer *buffer) {
+	assert(buffer->impl == &shm_client_buffer_impl);
+	return (struct wlr_shm_client_buffer *)buffer;
+}
+
+static void shm_client_buffer_destroy(struct wlr_buffer *wlr_buffer) {
+	struct wlr_shm_client_buffer *buffer =
+		shm_client_buffer_from_buffer(wlr_buffer);
+	wl_list_remove(&buffer->resource_destroy.link);
+	wl_shm_pool_unref(buffer->saved_shm_pool);
+	free(buffer);
+}
+
+static bool shm_client_buffer_begin_data_ptr_access(
+		struct wlr_buffer *wlr_buffer, void **data, uint32_t *format,
+		size_t *stride) {
+	struct wlr_shm_client_buffer *buffer =
+		shm_client_buffer_from_buffer(wlr_buffer);
+	*format = buffer->format;
+	*stride = buffer->stride;
+	if (buffer->shm_buffer != NULL) {
+		// Protects against the client truncating the file
+		wl_shm_buffer_begin_access(buffer->shm_buffer);
+		*data = wl_shm_buffer_get_data(buffer->shm_buffer);
+	} else {
+		*data = buffer->saved_data;
+	}
+	return true;
+}
+
+static void shm_client_buffer_end_data_ptr_access(
+		struct wlr_buffer *wlr_buffer) {
+	struct wlr_shm_client_buffer *buffer =
+		shm_client_buffer_from_buffer(wlr_buffer);
+	if (buffer->shm_buffer != NULL) {
+		wl_shm_buffer_end_access(buffer->shm_buffer);
+	}
+}
+
+static const struct wlr_buffer_impl shm_client_buffer_impl = {
+	.destroy = shm_client_buffer_destroy,
+	.begin_data_ptr_access = shm_client_buffer_begin_data_ptr_access,
+	.end_data_ptr_access = shm_client_buffer_end_data_ptr_access,
+};
+
+static void shm_client_buffer_resource_handle_destroy(
+		struct wl_listener *listener, void *data) {
+	struct wlr_shm_client_buffer *buffer =
+		wl_container_of(listener, buffer, resource_destroy);
+
+	// In order to still be able to access the shared memory region, we need
+	// to keep a reference to the wl_shm_pool
+	buffer->saved_data = wl_shm_buffer_get_data(buffer->shm_buffer);
+
+	buffer->resource = NULL;
+	buffer->shm_buffer = NULL;
+	wl_list_remove(&buffer->resource_destroy.link);
+	wl_list_init(&buffer->resource_destroy.link);
+}
+
+struct wlr_shm_client_buffer *shm_client_buffer_create(
+		struct wl_resource *resource) {
+	struct wl_shm_buffer *shm_buffer = wl_shm_buffer_get(resource);
+	assert(shm_buffer != NULL);
+
+	int32_t width = wl_shm_buffer_get_width(shm_buffer);
+	int32_t height = wl_shm_buffer_get_height(shm_buffer);
+
+	struct wlr_shm_client_buffer *buffer = calloc(1, sizeof(*buffer));
+	if (buffer == NULL) {
+		return NULL;
+	}
+	wlr_buffer_init(&buffer->base, &shm_client_buffer_impl, width, height);
+
+	buffer->resource = resource;
+	buffer->shm_buffer = shm_buffer;
+
+	enum wl_shm_format wl_shm_format = wl_shm_buffer_get_format(shm_buffer);
+	buffer->format = convert_wl_shm_format_to_drm(wl_shm_format);
+	buffer->stride = wl_shm_buffer_get_stride(shm_buffer);
+
+	// Keep the pool mapped, and prevent it from being re-mapped elsewhere,
+	// for as long as we may access it
+	buffer->saved_shm_pool = wl_shm_buffer_ref_pool(shm_buffer);
+
+	buffer->resource_destroy.notify = shm_client_buffer_resource_handle_destroy;
+	wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
+
+	return buffer;
+}
+
 static const struct wlr_buffer_impl client_buffer_impl;
 
 struct wlr_client_buffer *wlr_client_buffer_get(struct wlr_buffer *buffer) {
@@ -119,7 +246,11 @@ static void client_buffer_destroy(struct wlr_buffer *_buffer) {
 	}
 
 	wl_list_remove(&buffer->resource_destroy.link);
-	wlr_texture_destroy(buffer->texture);
+	if (buffer->dmabuf != NULL) {
+		dmabuf_v1_buffer_unref_texture(buffer->dmabuf);
+	} else {
+		wlr_texture_destroy(buffer->texture);
+	}
 	free(buffer);
 }
 
@@ -174,15 +305,50 @@ static void client_buffer_handle_release(struct wl_listener *listener,
 	}
 }
 
+static struct wlr_texture *import_shm_in_place(struct wlr_renderer *renderer,
+		struct wl_resource *resource, struct wlr_buffer **source) {
+	if (renderer->impl->texture_from_buffer == NULL) {
+		// Don't bother wrapping the buffer and referencing its pool for
+		// renderers which can only upload a copy
+		return NULL;
+	}
+
+	struct wlr_shm_client_buffer *buffer = shm_client_buffer_create(resource);
+	if (buffer == NULL) {
+		return NULL;
+	}
+
+	struct wlr_texture *texture =
+		wlr_texture_from_buffer(renderer, &buffer->base);
+	if (texture != NULL) {
+		*source = &buffer->base;
+	}
+
+	// The texture holds a lock on the buffer, if any
+	wlr_buffer_drop(&buffer->base);
+	return texture;
+}
+
 struct wlr_client_buffer *wlr_client_buffer_import(
 		struct wlr_renderer *renderer, struct wl_resource *resource) {
 	assert(wlr_resource_is_buffer(resource));
 
 	struct wlr_texture *texture = NULL;
+	struct wlr_buffer *source = NULL;
+	struct wlr_dmabuf_v1_buffer *cached_dmabuf = NULL;
 	bool resource_released = false;
 
 	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
 	if (shm_buf != NULL) {
+		// If the renderer supports it, sample from the client's memory
+		// directly instead of uploading a copy. In that case the wl_buffer is
+		// released once we're done with the texture.
+		texture = import_shm_in_place(renderer, resource, &source);
+	}
+
+	if (texture != NULL) {
+		// Imported in place, nothing else to do
+	} else if (shm_buf != NULL) {
 		enum wl_shm_format wl_shm_format = wl_shm_buffer_get_format(shm_buf);
 		uint32_t drm_format = convert_wl_shm_format_to_drm(wl_shm_format);
 		int32_t stride = wl_shm_buffer_get_stride(shm_buf);
@@ -204,7 +370,15 @@ struct wlr_client_buffer *wlr_client_buffer_import(
 	} else if (wlr_dmabuf_v1_resource_is_buffer(resource)) {
 		struct wlr_dmabuf_v1_buffer *dmabuf =
 			wlr_dmabuf_v1_buffer_from_buffer_resource(resource);
-		texture = wlr_texture_from_dmabuf(renderer, &dmabuf->attributes);
+		if (dmabuf->renderer == renderer) {
+			// Re-use the texture imported on previous commits of this buffer
+			texture = dmabuf_v1_buffer_ref_texture(dmabuf);
+			if (texture != NULL) {
+				cached_dmabuf = dmabuf;
+			}
+		} else {
+			texture = wlr_texture_from_dmabuf(renderer, &dmabuf->attributes);
+		}
 
 		// We have imported the DMA-BUF, but we need to prevent the client from
 		// re-using the same DMA-BUF for the next frames, so we don't release
@@ -227,7 +401,11 @@ struct wlr_client_buffer *wlr_client_buffer_import(
 	struct wlr_client_buffer *buffer =
 		calloc(1, sizeof(struct wlr_client_buffer));
 	if (buffer == NULL) {
-		wlr_texture_destroy(texture);
+		if (cached_dmabuf != NULL) {
+			dmabuf_v1_buffer_unref_texture(cached_dmabuf);
+		} else {
+			wlr_texture_destroy(texture);
+		}
 		wl_resource_post_no_memory(resource);
 		return NULL;
 	}
@@ -235,6 +413,8 @@ struct wlr_client_buffer *wlr_client_buffer_import(
 		texture->width, texture->height);
 	buffer->resource = resource;
 	buffer->texture = texture;
+	buffer->source = source;
+	buffer->dmabuf = cached_dmabuf;
 	buffer->resource_released = resource_released;
 
 	wl_resource_add_destroy_listener(resource, &buffer->resource_destroy);
@@ -250,6 +430,10 @@ struct wlr_client_buffer *wlr_client_buffer_import(
 	return buffer;
 }
 
+// Damage uploads trade a few extra pixels for fewer, larger copies
+#define SHM_UPLOAD_MAX_RECTS 16
+#define SHM_UPLOAD_MAX_WASTE 0.1f
+
 struct wlr_client_buffer *wlr_client_buffer_apply_damage(
 		struct wlr_client_buffer *buffer, struct wl_resource *resource,
 		pixman_region32_t *damage) {
@@ -260,6 +444,12 @@ struct wlr_client_buffer *wlr_client_buffer_apply_damage(
 		return NULL;
 	}
 
+	if (buffer->source != NULL) {
+		// The texture samples from the client's memory directly and can't be
+		// updated in-place
+		return NULL;
+	}
+
 	struct wl_shm_buffer *shm_buf = wl_shm_buffer_get(resource);
 	struct wl_shm_buffer *old_shm_buf = wl_shm_buffer_get(buffer->resource);
 	if (shm_buf == NULL || old_shm_buf == NULL) {
@@ -287,16 +477,18 @@ struct wlr_client_buffer *wlr_client_buffer_apply_damage(
 	wl_shm_buffer_begin_access(shm_buf);
 	void *data = wl_shm_buffer_get_data(shm_buf);
 
-	int n;
-	pixman_box32_t *rects = pixman_region32_rectangles(damage, &n);
-	for (int i = 0; i < n; ++i) {
-		pixman_box32_t *r = &rects[i];
-		if (!wlr_texture_write_pixels(buffer->texture, stride,
-				r->x2 - r->x1, r->y2 - r->y1, r->x1, r->y1,
-				r->x1, r->y1, data)) {
-			wl_shm_buffer_end_access(shm_buf);
-			return NULL;
-		}
+	pixman_region32_t upload;
+	pixman_region32_init(&upload);
+	wlr_region_simplify(&upload, damage, SHM_UPLOAD_MAX_RECTS,
+		SHM_UPLOAD_MAX_WASTE);
+	pixman_region32_intersect_rect(&upload, &upload, 0, 0, width, height);
+
+	bool ok = wlr_texture_write_pixels_region(buffer->texture, stride,
+		&upload, data);
+	pixman_region32_fini(&upload);
+	if (!ok) {
+		wl_shm_buffer_end_access(shm_buf);
+		return NULL;
 	}
 
 	wl_shm_buffer_end_access(shm_buf);
@@ -3,6 +3,7 @@
 #include <math.h>
 #include <stdlib.h>
 #include <wayland-server-core.h>
+#include <wlr/interfaces/wlr_output.h>
 #include <wlr/types/wlr_cursor.h>
 #include <wlr/types/wlr_input_device.h>
 #include <wlr/types/wlr_output_layout.h>
@@ -20,6 +21,10 @@ struct wlr_cursor_device {
 	struct wlr_output *mapped_output;
 	struct wlr_box *mapped_box;
 
+	// accumulated relative motion, when motion coalescing is enabled
+	bool motion_pending;
+	struct wlr_event_pointer_motion pending_motion;
+
 	struct wl_listener motion;
 	struct wl_listener motion_absolute;
 	struct wl_listener button;
@@ -50,7 +55,13 @@ struct wlr_cursor_output_cursor {
 	struct wlr_output_cursor *output_cursor;
 	struct wl_list link;
 
+	// latched position in output-local coordinates, when moves are batched
+	bool move_pending;
+	double pending_x, pending_y;
+
 	struct wl_listener layout_output_destroy;
+	struct wl_listener output_frame;
+	struct wl_listener output_precommit;
 };
 
 struct wlr_cursor_state {
@@ -61,6 +72,12 @@ struct wlr_cursor_state {
 	struct wlr_output *mapped_output;
 	struct wlr_box *mapped_box;
 
+	int motion_coalescing_interval; // ms, 0 if disabled
+	struct wl_event_source *motion_timer;
+	bool motion_pending;
+
+	bool batched_moves;
+
 	struct wl_listener layout_add;
 	struct wl_listener layout_change;
 	struct wl_listener layout_destroy;
@@ -120,6 +137,8 @@ struct wlr_cursor *wlr_cursor_create(void) {
 static void output_cursor_destroy(
 		struct wlr_cursor_output_cursor *output_cursor) {
 	wl_list_remove(&output_cursor->layout_output_destroy.link);
+	wl_list_remove(&output_cursor->output_frame.link);
+	wl_list_remove(&output_cursor->output_precommit.link);
 	wl_list_remove(&output_cursor->link);
 	wlr_output_cursor_destroy(output_cursor->output_cursor);
 	free(output_cursor);
@@ -169,6 +188,7 @@ static void cursor_device_destroy(struct wlr_cursor_device *c_device) {
 		wl_list_remove(&c_device->tablet_tool_button.link);
 	}
 
+	// Any pending motion of the device is dropped
 	wl_list_remove(&c_device->link);
 	wl_list_remove(&c_device->destroy.link);
 	free(c_device);
@@ -182,6 +202,9 @@ void wlr_cursor_destroy(struct wlr_cursor *cur) {
 		cursor_device_destroy(device);
 	}
 
+	if (cur->state->motion_timer != NULL) {
+		wl_event_source_remove(cur->state->motion_timer);
+	}
 	free(cur->state);
 	free(cur);
 }
@@ -199,6 +222,61 @@ static struct wlr_cursor_device *get_cursor_device(struct wlr_cursor *cur,
 	return ret;
 }
 
+/**
+ * Check whether the image of an output cursor would be visible at the given
+ * output-local position.
+ */
+static bool output_cursor_visible_at(struct wlr_output_cursor *output_cursor,
+		double x, double y) {
+	struct wlr_output *output = output_cursor->output;
+	if (!output_cursor->enabled) {
+		return false;
+	}
+
+	int width, height;
+	wlr_output_transformed_resolution(output, &width, &height);
+
+	double box_x = x * output->scale - output_cursor->hotspot_x;
+	double box_y = y * output->scale - output_cursor->hotspot_y;
+	return box_x < width && box_y < height &&
+		box_x + output_cursor->width > 0 && box_y + output_cursor->height > 0;
+}
+
+static void output_cursor_move(struct wlr_cursor_output_cursor *output_cursor,
+		double x, double y) {
+	struct wlr_cursor_state *state = output_cursor->cursor->state;
+	struct wlr_output_cursor *wlr_output_cursor = output_cursor->output_cursor;
+	struct wlr_output *output = wlr_output_cursor->output;
+
+	// Software cursors need to be moved right away, so that the damage is
+	// known before rendering
+	if (!state->batched_moves || output->hardware_cursor != wlr_output_cursor) {
+		output_cursor->move_pending = false;
+		wlr_output_cursor_move(wlr_output_cursor, x, y);
+		return;
+	}
+
+	// Latch the position until the next output commit. Only request a new
+	// frame if the cursor is or will be visible on the output.
+	output_cursor->move_pending = true;
+	output_cursor->pending_x = x;
+	output_cursor->pending_y = y;
+	if (wlr_output_cursor->visible ||
+			output_cursor_visible_at(wlr_output_cursor, x, y)) {
+		wlr_output_update_needs_frame(output);
+	}
+}
+
+static void output_cursor_apply_move(
+		struct wlr_cursor_output_cursor *output_cursor) {
+	if (!output_cursor->move_pending) {
+		return;
+	}
+	output_cursor->move_pending = false;
+	wlr_output_cursor_move(output_cursor->output_cursor,
+		output_cursor->pending_x, output_cursor->pending_y);
+}
+
 static void cursor_warp_unchecked(struct wlr_cursor *cur,
 		double lx, double ly) {
 	assert(cur->state->layout);
@@ -208,8 +286,7 @@ static void cursor_warp_unchecked(struct wlr_cursor *cur,
 		double output_x = lx, output_y = ly;
 		wlr_output_layout_output_coords(cur->state->layout,
 			output_cursor->output_cursor->output, &output_x, &output_y);
-		wlr_output_cursor_move(output_cursor->output_cursor,
-			output_x, output_y);
+		output_cursor_move(output_cursor, output_x, output_y);
 	}
 
 	cur->x = lx;
@@ -327,6 +404,18 @@ void wlr_cursor_move(struct wlr_cursor *cur, struct wlr_input_device *dev,
 	wlr_cursor_warp_closest(cur, dev, lx, ly);
 }
 
+void wlr_cursor_set_batched_moves(struct wlr_cursor *cur, bool batched) {
+	cur->state->batched_moves = batched;
+	if (batched) {
+		return;
+	}
+
+	struct wlr_cursor_output_cursor *output_cursor;
+	wl_list_for_each(output_cursor, &cur->state->output_cursors, link) {
+		output_cursor_apply_move(output_cursor);
+	}
+}
+
 void wlr_cursor_set_image(struct wlr_cursor *cur, const uint8_t *pixels,
 		int32_t stride, uint32_t width, uint32_t height, int32_t hotspot_x,
 		int32_t hotspot_y, float scale) {
@@ -351,11 +440,93 @@ void wlr_cursor_set_surface(struct wlr_cursor *cur, struct wlr_surface *surface,
 	}
 }
 
+/**
+ * Emit the motion accumulated by all devices of the cursor, if any.
+ */
+static void cursor_flush_motion(struct wlr_cursor *cur) {
+	struct wlr_cursor_state *state = cur->state;
+	if (!state->motion_pending) {
+		return;
+	}
+	state->motion_pending = false;
+	wl_event_source_timer_update(state->motion_timer, 0);
+
+	struct wlr_cursor_device *device, *tmp;
+	wl_list_for_each_safe(device, tmp, &state->devices, link) {
+		if (!device->motion_pending) {
+			continue;
+		}
+		device->motion_pending = false;
+
+		// The listeners may destroy the device, emit a copy of the event
+		struct wlr_event_pointer_motion event = device->pending_motion;
+		wlr_signal_emit_safe(&cur->events.motion, &event);
+		wlr_signal_emit_safe(&cur->events.frame, cur);
+	}
+}
+
+static int handle_motion_timer(void *data) {
+	struct wlr_cursor_state *state = data;
+	cursor_flush_motion(state->cursor);
+	return 0;
+}
+
+void wlr_cursor_set_motion_coalescing(struct wlr_cursor *cur,
+		struct wl_event_loop *loop, int interval_ms) {
+	struct wlr_cursor_state *state = cur->state;
+	if (interval_ms < 0) {
+		interval_ms = 0;
+	}
+
+	if (interval_ms == 0) {
+		if (state->motion_timer != NULL) {
+			cursor_flush_motion(cur);
+			wl_event_source_remove(state->motion_timer);
+			state->motion_timer = NULL;
+		}
+		state->motion_coalescing_interval = 0;
+		return;
+	}
+
+	if (state->motion_timer == NULL) {
+		state->motion_timer =
+			wl_event_loop_add_timer(loop, handle_motion_timer, state);
+		if (state->motion_timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create motion coalescing timer");
+			return;
+		}
+	}
+	state->motion_coalescing_interval = interval_ms;
+}
+
 static void handle_pointer_motion(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_motion *event = data;
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, motion);
-	wlr_signal_emit_safe(&device->cursor->events.motion, event);
+	struct wlr_cursor_state *state = device->cursor->state;
+
+	if (state->motion_coalescing_interval == 0) {
+		wlr_signal_emit_safe(&device->cursor->events.motion, event);
+		return;
+	}
+
+	struct wlr_event_pointer_motion *pending = &device->pending_motion;
+	if (!device->motion_pending) {
+		*pending = *event;
+		device->motion_pending = true;
+	} else {
+		pending->time_msec = event->time_msec;
+		pending->delta_x += event->delta_x;
+		pending->delta_y += event->delta_y;
+		pending->unaccel_dx += event->unaccel_dx;
+		pending->unaccel_dy += event->unaccel_dy;
+	}
+
+	if (!state->motion_pending) {
+		state->motion_pending = true;
+		wl_event_source_timer_update(state->motion_timer,
+			state->motion_coalescing_interval);
+	}
 }
 
 static void apply_output_transform(double *x, double *y,
@@ -421,6 +592,7 @@ static void handle_pointer_motion_absolute(struct wl_listener *listener,
 	struct wlr_event_pointer_motion_absolute *event = data;
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, motion_absolute);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output =
 		get_mapped_output(device);
@@ -434,53 +606,65 @@ static void handle_pointer_button(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_button *event = data;
 	struct wlr_cursor_device *device =
 		wl_container_of(listener, device, button);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.button, event);
 }
 
 static void handle_pointer_axis(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_axis *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, axis);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.axis, event);
 }
 
 static void handle_pointer_frame(struct wl_listener *listener, void *data) {
 	struct wlr_cursor_device *device = wl_container_of(listener, device, frame);
+	if (device->motion_pending) {
+		// The frame is emitted along with the coalesced motion
+		return;
+	}
 	wlr_signal_emit_safe(&device->cursor->events.frame, device->cursor);
 }
 
 static void handle_pointer_swipe_begin(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_swipe_begin *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_begin);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.swipe_begin, event);
 }
 
 static void handle_pointer_swipe_update(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_swipe_update *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_update);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.swipe_update, event);
 }
 
 static void handle_pointer_swipe_end(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_swipe_end *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, swipe_end);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.swipe_end, event);
 }
 
 static void handle_pointer_pinch_begin(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_pinch_begin *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_begin);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.pinch_begin, event);
 }
 
 static void handle_pointer_pinch_update(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_pinch_update *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_update);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.pinch_update, event);
 }
 
 static void handle_pointer_pinch_end(struct wl_listener *listener, void *data) {
 	struct wlr_event_pointer_pinch_end *event = data;
 	struct wlr_cursor_device *device = wl_container_of(listener, device, pinch_end);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.pinch_end, event);
 }
 
@@ -488,6 +672,7 @@ static void handle_touch_up(struct wl_listener *listener, void *data) {
 	struct wlr_event_touch_up *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_up);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.touch_up, event);
 }
 
@@ -495,6 +680,7 @@ static void handle_touch_down(struct wl_listener *listener, void *data) {
 	struct wlr_event_touch_down *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_down);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output =
 		get_mapped_output(device);
@@ -508,6 +694,7 @@ static void handle_touch_motion(struct wl_listener *listener, void *data) {
 	struct wlr_event_touch_motion *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_motion);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output =
 		get_mapped_output(device);
@@ -521,6 +708,7 @@ static void handle_touch_cancel(struct wl_listener *listener, void *data) {
 	struct wlr_event_touch_cancel *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, touch_cancel);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.touch_cancel, event);
 }
 
@@ -528,6 +716,7 @@ static void handle_tablet_tool_tip(struct wl_listener *listener, void *data) {
 	struct wlr_event_tablet_tool_tip *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, tablet_tool_tip);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output =
 		get_mapped_output(device);
@@ -541,6 +730,7 @@ static void handle_tablet_tool_axis(struct wl_listener *listener, void *data) {
 	struct wlr_event_tablet_tool_axis *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, tablet_tool_axis);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output = get_mapped_output(device);
 	if (output) {
@@ -577,6 +767,7 @@ static void handle_tablet_tool_button(struct wl_listener *listener,
 	struct wlr_event_tablet_tool_button *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, tablet_tool_button);
+	cursor_flush_motion(device->cursor);
 	wlr_signal_emit_safe(&device->cursor->events.tablet_tool_button, event);
 }
 
@@ -585,6 +776,7 @@ static void handle_tablet_tool_proximity(struct wl_listener *listener,
 	struct wlr_event_tablet_tool_proximity *event = data;
 	struct wlr_cursor_device *device;
 	device = wl_container_of(listener, device, tablet_tool_proximity);
+	cursor_flush_motion(device->cursor);
 
 	struct wlr_output *output =
 		get_mapped_output(device);
@@ -730,6 +922,19 @@ static void handle_layout_output_destroy(struct wl_listener *listener,
 	output_cursor_destroy(output_cursor);
 }
 
+static void handle_output_frame(struct wl_listener *listener, void *data) {
+	struct wlr_cursor_output_cursor *output_cursor =
+		wl_container_of(listener, output_cursor, output_frame);
+	cursor_flush_motion(output_cursor->cursor);
+}
+
+static void handle_output_precommit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_cursor_output_cursor *output_cursor =
+		wl_container_of(listener, output_cursor, output_precommit);
+	output_cursor_apply_move(output_cursor);
+}
+
 static void layout_add(struct wlr_cursor_state *state,
 		struct wlr_output_layout_output *l_output) {
 	struct wlr_cursor_output_cursor *output_cursor;
@@ -757,6 +962,15 @@ static void layout_add(struct wlr_cursor_state *state,
 	wl_signal_add(&l_output->events.destroy,
 		&output_cursor->layout_output_destroy);
 
+	// Coalesced motion must be flushed before the compositor renders the
+	// frame, so run ahead of the frame listeners already registered
+	output_cursor->output_frame.notify = handle_output_frame;
+	wl_list_insert(&l_output->output->events.frame.listener_list,
+		&output_cursor->output_frame.link);
+	output_cursor->output_precommit.notify = handle_output_precommit;
+	wl_signal_add(&l_output->output->events.precommit,
+		&output_cursor->output_precommit);
+
 	wl_list_insert(&state->output_cursors, &output_cursor->link);
 }
 
@@ -2,11 +2,13 @@
 #include <assert.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/interfaces/wlr_keyboard.h>
 #include <wlr/types/wlr_keyboard.h>
 #include <wlr/util/log.h>
 #include "types/wlr_keyboard.h"
+#include "util/shm.h"
 #include "util/signal.h"
 
 void keyboard_led_update(struct wlr_keyboard *keyboard) {
@@ -119,6 +121,8 @@ void wlr_keyboard_init(struct wlr_keyboard *kb,
 	wl_signal_init(&kb->events.repeat_info);
 	wl_signal_init(&kb->events.destroy);
 
+	kb->keymap_fd = -1;
+
 	// Sane defaults
 	kb->repeat_info.rate = 25;
 	kb->repeat_info.delay = 600;
@@ -132,6 +136,9 @@ void wlr_keyboard_destroy(struct wlr_keyboard *kb) {
 	xkb_state_unref(kb->xkb_state);
 	xkb_keymap_unref(kb->keymap);
 	free(kb->keymap_string);
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+	}
 	if (kb->impl && kb->impl->destroy) {
 		kb->impl->destroy(kb);
 	} else {
@@ -192,6 +199,17 @@ bool wlr_keyboard_set_keymap(struct wlr_keyboard *kb,
 	kb->keymap_string = tmp_keymap_string;
 	kb->keymap_size = strlen(kb->keymap_string) + 1;
 
+	// Clients are sent a shared sealed copy of the keymap if possible,
+	// otherwise a copy is made for each of them
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+	}
+	kb->keymap_fd = allocate_sealed_shm_file(kb->keymap_string,
+		kb->keymap_size);
+	if (kb->keymap_fd < 0) {
+		wlr_log_errno(WLR_DEBUG, "Failed to create a sealed keymap file");
+	}
+
 	for (size_t i = 0; i < kb->num_keycodes; ++i) {
 		xkb_keycode_t keycode = kb->keycodes[i] + 8;
 		xkb_state_update_key(kb->xkb_state, keycode, XKB_KEY_DOWN);
@@ -209,6 +227,10 @@ err:
 	kb->keymap = NULL;
 	free(kb->keymap_string);
 	kb->keymap_string = NULL;
+	if (kb->keymap_fd >= 0) {
+		close(kb->keymap_fd);
+		kb->keymap_fd = -1;
+	}
 	return false;
 }
 
@@ -9,6 +9,7 @@
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
 #include <wlr/util/log.h>
 #include "linux-dmabuf-unstable-v1-protocol.h"
+#include "types/wlr_linux_dmabuf_v1.h"
 #include "util/signal.h"
 
 #define LINUX_DMABUF_VERSION 3
@@ -54,10 +55,40 @@ struct wlr_dmabuf_v1_buffer *wlr_dmabuf_v1_buffer_from_buffer_resource(
 }
 
 static void linux_dmabuf_buffer_destroy(struct wlr_dmabuf_v1_buffer *buffer) {
+	wl_list_remove(&buffer->renderer_destroy.link);
+	wlr_texture_destroy(buffer->texture);
 	wlr_dmabuf_attributes_finish(&buffer->attributes);
 	free(buffer);
 }
 
+struct wlr_texture *dmabuf_v1_buffer_ref_texture(
+		struct wlr_dmabuf_v1_buffer *buffer) {
+	if (buffer->renderer == NULL) {
+		return NULL;
+	}
+	if (buffer->texture == NULL) {
+		buffer->texture =
+			wlr_texture_from_dmabuf(buffer->renderer, &buffer->attributes);
+		if (buffer->texture == NULL) {
+			return NULL;
+		}
+	} else {
+		// The client may have rendered into the DMA-BUF since the texture
+		// was last used
+		wlr_texture_invalidate(buffer->texture);
+	}
+	buffer->n_refs++;
+	return buffer->texture;
+}
+
+void dmabuf_v1_buffer_unref_texture(struct wlr_dmabuf_v1_buffer *buffer) {
+	assert(buffer->n_refs > 0);
+	buffer->n_refs--;
+	if (buffer->n_refs == 0) {
+		linux_dmabuf_buffer_destroy(buffer);
+	}
+}
+
 static void params_destroy(struct wl_client *client,
 		struct wl_resource *resource) {
 	wl_resource_destroy(resource);
@@ -118,20 +149,33 @@ static void params_add(struct wl_client *client,
 static void buffer_handle_resource_destroy(struct wl_resource *buffer_resource) {
 	struct wlr_dmabuf_v1_buffer *buffer =
 		wlr_dmabuf_v1_buffer_from_buffer_resource(buffer_resource);
-	linux_dmabuf_buffer_destroy(buffer);
+	buffer->buffer_resource = NULL;
+	// The texture may still be in use by client buffers
+	dmabuf_v1_buffer_unref_texture(buffer);
+}
+
+static void buffer_handle_renderer_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_dmabuf_v1_buffer *buffer =
+		wl_container_of(listener, buffer, renderer_destroy);
+	// The texture can't outlive its renderer, further imports of the buffer
+	// aren't cached anymore
+	wlr_texture_destroy(buffer->texture);
+	buffer->texture = NULL;
+	buffer->renderer = NULL;
+	wl_list_remove(&buffer->renderer_destroy.link);
+	wl_list_init(&buffer->renderer_destroy.link);
 }
 
 static bool check_import_dmabuf(struct wlr_dmabuf_v1_buffer *buffer) {
-	struct wlr_texture *texture =
-		wlr_texture_from_dmabuf(buffer->renderer, &buffer->attributes);
-	if (texture == NULL) {
+	if (buffer->renderer == NULL) {
 		return false;
 	}
-
-	// We can import the image, good. No need to keep it since wlr_surface will
-	// import it again on commit.
-	wlr_texture_destroy(texture);
-	return true;
+	// We can import the image, good. Keep it around since wlr_surface will
+	// need it on commit.
+	buffer->texture =
+		wlr_texture_from_dmabuf(buffer->renderer, &buffer->attributes);
+	return buffer->texture != NULL;
 }
 
 static void params_create_common(struct wl_client *client,
@@ -256,6 +300,7 @@ static void params_create_common(struct wl_client *client,
 
 	wl_resource_set_implementation(buffer->buffer_resource,
 		&buffer_impl, buffer, buffer_handle_resource_destroy);
+	buffer->n_refs = 1;
 
 	/* send 'created' event when the request is not for an immediate
 	 * import, that is buffer_id is zero */
@@ -357,6 +402,9 @@ static void linux_dmabuf_create_params(struct wl_client *client,
 
 	wl_resource_set_implementation(buffer->params_resource,
 		&linux_buffer_params_impl, buffer, handle_params_destroy);
+
+	buffer->renderer_destroy.notify = buffer_handle_renderer_destroy;
+	wl_signal_add(&buffer->renderer->events.destroy, &buffer->renderer_destroy);
 	return;
 
 err_free:
@@ -18,8 +18,11 @@
 #include <wlr/util/region.h>
 #include "util/global.h"
 #include "util/signal.h"
+#include "util/time.h"
+#include "util/trace.h"
 
 #define OUTPUT_VERSION 3
+#define FRAME_SCHEDULER_DEFAULT_MARGIN_NS 2000000
 
 static void send_geometry(struct wl_resource *resource) {
 	struct wlr_output *output = wlr_output_from_resource(resource);
@@ -357,6 +360,10 @@ void wlr_output_init(struct wlr_output *output, struct wlr_backend *backend,
 	wl_signal_init(&output->events.destroy);
 	pixman_region32_init(&output->pending.damage);
 
+	output->frame_scheduler.margin_ns = FRAME_SCHEDULER_DEFAULT_MARGIN_NS;
+	output->frame_scheduler.frame_ns = -1;
+	output->frame_scheduler.vblank_ns = -1;
+
 	const char *no_hardware_cursors = getenv("WLR_NO_HARDWARE_CURSORS");
 	if (no_hardware_cursors != NULL && strcmp(no_hardware_cursors, "1") == 0) {
 		wlr_log(WLR_DEBUG,
@@ -393,6 +400,10 @@ void wlr_output_destroy(struct wlr_output *output) {
 		wl_event_source_remove(output->idle_done);
 	}
 
+	if (output->frame_scheduler.timer != NULL) {
+		wl_event_source_remove(output->frame_scheduler.timer);
+	}
+
 	free(output->description);
 
 	pixman_region32_fini(&output->pending.damage);
@@ -583,6 +594,56 @@ bool wlr_output_test(struct wlr_output *output) {
 	return output->impl->test(output);
 }
 
+static int64_t output_get_refresh_period_ns(struct wlr_output *output) {
+	if (output->refresh <= 0) {
+		return 0;
+	}
+	return 1000000000000 / output->refresh;
+}
+
+static void frame_scheduler_handle_commit(struct wlr_output *output,
+		const struct timespec *now) {
+	struct wlr_output_frame_scheduler *scheduler = &output->frame_scheduler;
+	if (scheduler->frame_ns < 0) {
+		// Not a response to a frame event
+		return;
+	}
+
+	int64_t now_ns = timespec_to_nsec(now);
+	int64_t render_ns = now_ns - scheduler->frame_ns;
+	scheduler->frame_ns = -1;
+
+	int64_t period_ns = output_get_refresh_period_ns(output);
+	if (period_ns > 0) {
+		// Frame events sent while idle don't have a vblank to miss
+		if (scheduler->enabled && scheduler->vblank_ns >= 0 &&
+				now_ns > scheduler->vblank_ns + period_ns) {
+			scheduler->missed_deadlines++;
+		}
+		// A frame which took longer than a whole period disables the delay
+		// until it leaves the history, no need to remember more than that
+		if (render_ns > period_ns) {
+			render_ns = period_ns;
+		}
+	}
+
+	scheduler->render_ns[scheduler->render_idx] = render_ns;
+	scheduler->render_idx =
+		(scheduler->render_idx + 1) % WLR_OUTPUT_FRAME_SCHEDULER_HISTORY_LEN;
+	if (scheduler->render_len < WLR_OUTPUT_FRAME_SCHEDULER_HISTORY_LEN) {
+		scheduler->render_len++;
+	}
+
+	// Predict the worst case of the recent frames, missing a deadline costs a
+	// whole period while over-estimating only costs a bit of latency
+	scheduler->predicted_render_ns = 0;
+	for (size_t i = 0; i < scheduler->render_len; i++) {
+		if (scheduler->render_ns[i] > scheduler->predicted_render_ns) {
+			scheduler->predicted_render_ns = scheduler->render_ns[i];
+		}
+	}
+}
+
 bool wlr_output_commit(struct wlr_output *output) {
 	if (!output_basic_test(output)) {
 		wlr_log(WLR_ERROR, "Basic output test failed for %s", output->name);
@@ -595,6 +656,8 @@ bool wlr_output_commit(struct wlr_output *output) {
 		output->idle_frame = NULL;
 	}
 
+	trace_begin("output_commit", "commit_seq", output->commit_seq + 1);
+
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
 
@@ -606,6 +669,7 @@ bool wlr_output_commit(struct wlr_output *output) {
 
 	if (!output->impl->commit(output)) {
 		output_state_clear(&output->pending);
+		trace_end("output_commit");
 		return false;
 	}
 
@@ -649,6 +713,16 @@ bool wlr_output_commit(struct wlr_output *output) {
 	if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
 		output->frame_pending = true;
 		output->needs_frame = false;
+		frame_scheduler_handle_commit(output, &now);
+	}
+
+	// A delayed frame event must not clear frame_pending while the committed
+	// buffer is still waiting for its vblank, or fire on a disabled output
+	bool disabled = (output->pending.committed & WLR_OUTPUT_STATE_ENABLED) &&
+		!output->pending.enabled;
+	if (((output->pending.committed & WLR_OUTPUT_STATE_BUFFER) || disabled) &&
+			output->frame_scheduler.timer != NULL) {
+		wl_event_source_timer_update(output->frame_scheduler.timer, 0);
 	}
 
 	uint32_t committed = output->pending.committed;
@@ -661,6 +735,7 @@ bool wlr_output_commit(struct wlr_output *output) {
 	};
 	wlr_signal_emit_safe(&output->events.commit, &event);
 
+	trace_end("output_commit");
 	return true;
 }
 
@@ -671,6 +746,12 @@ void wlr_output_rollback(struct wlr_output *output) {
 		output->impl->rollback_render(output);
 	}
 
+	// Nothing was rendered for the last frame event, don't let the next
+	// commit count the idle time as render time
+	if (output->pending.committed & WLR_OUTPUT_STATE_BUFFER) {
+		output->frame_scheduler.frame_ns = -1;
+	}
+
 	output_state_clear(&output->pending);
 }
 
@@ -682,16 +763,74 @@ void wlr_output_attach_buffer(struct wlr_output *output,
 	output->pending.buffer = wlr_buffer_lock(buffer);
 }
 
-void wlr_output_send_frame(struct wlr_output *output) {
+static void output_emit_frame(struct wlr_output *output) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	output->frame_scheduler.frame_ns = timespec_to_nsec(&now);
+
+	trace_instant("output_frame", NULL, 0);
+
 	output->frame_pending = false;
 	wlr_signal_emit_safe(&output->events.frame, output);
 }
 
+static int frame_scheduler_handle_timer(void *data) {
+	struct wlr_output *output = data;
+	output_emit_frame(output);
+	return 0;
+}
+
+static int frame_scheduler_get_delay_ms(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *scheduler = &output->frame_scheduler;
+	int64_t period_ns = output_get_refresh_period_ns(output);
+	if (!scheduler->enabled || period_ns == 0 ||
+			scheduler->render_len < WLR_OUTPUT_FRAME_SCHEDULER_HISTORY_LEN) {
+		return 0;
+	}
+
+	int64_t delay_ns = period_ns - scheduler->predicted_render_ns -
+		scheduler->margin_ns;
+	// Event loop timers have a millisecond granularity, round down to make
+	// sure the deadline isn't missed
+	return delay_ns > 0 ? delay_ns / 1000000 : 0;
+}
+
+void wlr_output_send_frame(struct wlr_output *output) {
+	struct wlr_output_frame_scheduler *scheduler = &output->frame_scheduler;
+
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	scheduler->vblank_ns = timespec_to_nsec(&now);
+	scheduler->delay_ns = 0;
+
+	int delay_ms = frame_scheduler_get_delay_ms(output);
+	if (delay_ms > 0 && scheduler->timer == NULL) {
+		struct wl_event_loop *ev = wl_display_get_event_loop(output->display);
+		scheduler->timer = wl_event_loop_add_timer(ev,
+			frame_scheduler_handle_timer, output);
+		if (scheduler->timer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create frame scheduler timer");
+		}
+	}
+	if (delay_ms > 0 && scheduler->timer != NULL) {
+		// Keep the frame pending until the timer fires, so that
+		// wlr_output_schedule_frame doesn't send another one
+		output->frame_pending = true;
+		scheduler->delay_ns = (int64_t)delay_ms * 1000000;
+		wl_event_source_timer_update(scheduler->timer, delay_ms);
+		return;
+	}
+
+	output_emit_frame(output);
+}
+
 static void schedule_frame_handle_idle_timer(void *data) {
 	struct wlr_output *output = data;
 	output->idle_frame = NULL;
 	if (!output->frame_pending) {
-		wlr_output_send_frame(output);
+		// Nothing is being displayed, there is no vblank to wait for
+		output->frame_scheduler.vblank_ns = -1;
+		output_emit_frame(output);
 	}
 }
 
@@ -712,6 +851,11 @@ void wlr_output_schedule_frame(struct wlr_output *output) {
 		wl_event_loop_add_idle(ev, schedule_frame_handle_idle_timer, output);
 }
 
+void wlr_output_enable_frame_scheduler(struct wlr_output *output,
+		bool enabled) {
+	output->frame_scheduler.enabled = enabled;
+}
+
 void wlr_output_send_present(struct wlr_output *output,
 		struct wlr_output_event_present *event) {
 	struct wlr_output_event_present _event = {0};
@@ -734,6 +878,8 @@ void wlr_output_send_present(struct wlr_output *output,
 		event->when = &now;
 	}
 
+	trace_instant("output_present", "commit_seq", event->commit_seq);
+
 	wlr_signal_emit_safe(&output->events.present, event);
 }
 
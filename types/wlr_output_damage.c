@@ -1,3 +1,4 @@
+#include <assert.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <time.h>
@@ -5,8 +6,13 @@
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output_damage.h>
 #include <wlr/types/wlr_output.h>
+#include <wlr/util/region.h>
+#include "render/swapchain.h"
 #include "util/signal.h"
 
+static_assert(WLR_OUTPUT_DAMAGE_PREVIOUS_LEN >= WLR_SWAPCHAIN_CAP - 1,
+	"Damage history is too short for the oldest swapchain buffer");
+
 static void output_handle_destroy(struct wl_listener *listener, void *data) {
 	struct wlr_output_damage *output_damage =
 		wl_container_of(listener, output_damage, output_destroy);
@@ -100,6 +106,7 @@ struct wlr_output_damage *wlr_output_damage_create(struct wlr_output *output) {
 
 	output_damage->output = output;
 	output_damage->max_rects = 20;
+	output_damage->max_waste = 0.1;
 	wl_signal_init(&output_damage->events.frame);
 	wl_signal_init(&output_damage->events.destroy);
 
@@ -174,13 +181,9 @@ bool wlr_output_damage_attach_render(struct wlr_output_damage *output_damage,
 			pixman_region32_union(damage, damage, &output_damage->previous[j]);
 		}
 
-		// Check the number of rectangles
-		int n_rects = pixman_region32_n_rects(damage);
-		if (n_rects > output_damage->max_rects) {
-			pixman_box32_t *extents = pixman_region32_extents(damage);
-			pixman_region32_union_rect(damage, damage, extents->x1, extents->y1,
-				extents->x2 - extents->x1, extents->y2 - extents->y1);
-		}
+		// Merge thin rectangles and limit the number of rectangles
+		wlr_region_simplify(damage, damage, output_damage->max_rects,
+			output_damage->max_waste);
 	}
 
 	return true;
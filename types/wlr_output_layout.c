@@ -2,21 +2,36 @@
 #include <float.h>
 #include <limits.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_output.h>
 #include <wlr/util/log.h>
 #include "util/signal.h"
 
+/**
+ * The layout is split in a grid along the edges of all outputs. Each cell of
+ * the grid references the first output in the layout list covering it, if
+ * any. This allows point lookups with two binary searches.
+ */
+struct wlr_output_layout_index {
+	int *xs, *ys; // sorted unique edges
+	size_t xs_len, ys_len;
+	// (xs_len - 1) * (ys_len - 1) cells, column-major
+	struct wlr_output_layout_output **cells;
+};
+
 struct wlr_output_layout_state {
-	struct wlr_box _box; // should never be read directly, use the getter
+	struct wlr_box _box; // extents, updated by output_layout_reconfigure
+	struct wlr_output_layout_index index;
 };
 
 struct wlr_output_layout_output_state {
 	struct wlr_output_layout *layout;
 	struct wlr_output_layout_output *l_output;
 
-	struct wlr_box _box; // should never be read directly, use the getter
+	struct wlr_box _box; // updated by output_layout_reconfigure
 	bool auto_configured;
 
 	struct wl_listener mode;
@@ -44,6 +59,13 @@ struct wlr_output_layout *wlr_output_layout_create(void) {
 	return layout;
 }
 
+static void output_layout_index_finish(struct wlr_output_layout_index *index) {
+	free(index->xs);
+	free(index->ys);
+	free(index->cells);
+	memset(index, 0, sizeof(*index));
+}
+
 static void output_layout_output_destroy(
 		struct wlr_output_layout_output *l_output) {
 	wlr_signal_emit_safe(&l_output->events.destroy, l_output);
@@ -68,19 +90,155 @@ void wlr_output_layout_destroy(struct wlr_output_layout *layout) {
 		output_layout_output_destroy(l_output);
 	}
 
+	output_layout_index_finish(&layout->state->index);
 	free(layout->state);
 	free(layout);
 }
 
 static struct wlr_box *output_layout_output_get_box(
 		struct wlr_output_layout_output *l_output) {
+	return &l_output->state->_box;
+}
+
+static void output_layout_output_update_box(
+		struct wlr_output_layout_output *l_output) {
 	l_output->state->_box.x = l_output->x;
 	l_output->state->_box.y = l_output->y;
 	int width, height;
 	wlr_output_effective_resolution(l_output->output, &width, &height);
 	l_output->state->_box.width = width;
 	l_output->state->_box.height = height;
-	return &l_output->state->_box;
+}
+
+static void output_layout_update_extents(struct wlr_output_layout *layout) {
+	int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
+	if (!wl_list_empty(&layout->outputs)) {
+		min_x = min_y = INT_MAX;
+		max_x = max_y = INT_MIN;
+		struct wlr_output_layout_output *l_output;
+		wl_list_for_each(l_output, &layout->outputs, link) {
+			struct wlr_box *box = output_layout_output_get_box(l_output);
+			if (box->x < min_x) {
+				min_x = box->x;
+			}
+			if (box->y < min_y) {
+				min_y = box->y;
+			}
+			if (box->x + box->width > max_x) {
+				max_x = box->x + box->width;
+			}
+			if (box->y + box->height > max_y) {
+				max_y = box->y + box->height;
+			}
+		}
+	}
+
+	layout->state->_box.x = min_x;
+	layout->state->_box.y = min_y;
+	layout->state->_box.width = max_x - min_x;
+	layout->state->_box.height = max_y - min_y;
+}
+
+static int compare_int(const void *_a, const void *_b) {
+	const int *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+static size_t sort_unique(int *values, size_t len) {
+	qsort(values, len, sizeof(int), compare_int);
+	size_t unique_len = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (unique_len == 0 || values[unique_len - 1] != values[i]) {
+			values[unique_len++] = values[i];
+		}
+	}
+	return unique_len;
+}
+
+/**
+ * Find the interval [edges[i], edges[i + 1]) containing the value. Returns -1
+ * if there is none.
+ */
+static ssize_t find_interval(const int *edges, size_t len, double value) {
+	if (len < 2 || !(value >= edges[0] && value < edges[len - 1])) {
+		return -1;
+	}
+	size_t low = 0, high = len - 1;
+	while (high - low > 1) {
+		size_t mid = low + (high - low) / 2;
+		if (value < edges[mid]) {
+			high = mid;
+		} else {
+			low = mid;
+		}
+	}
+	return low;
+}
+
+static void output_layout_update_index(struct wlr_output_layout *layout) {
+	struct wlr_output_layout_index *index = &layout->state->index;
+	output_layout_index_finish(index);
+
+	size_t outputs_len = wl_list_length(&layout->outputs);
+	if (outputs_len == 0) {
+		return;
+	}
+
+	index->xs = calloc(2 * outputs_len, sizeof(int));
+	index->ys = calloc(2 * outputs_len, sizeof(int));
+	if (index->xs == NULL || index->ys == NULL) {
+		goto error;
+	}
+
+	struct wlr_output_layout_output *l_output;
+	wl_list_for_each(l_output, &layout->outputs, link) {
+		struct wlr_box *box = output_layout_output_get_box(l_output);
+		if (wlr_box_empty(box)) {
+			continue;
+		}
+		index->xs[index->xs_len++] = box->x;
+		index->xs[index->xs_len++] = box->x + box->width;
+		index->ys[index->ys_len++] = box->y;
+		index->ys[index->ys_len++] = box->y + box->height;
+	}
+	if (index->xs_len == 0) {
+		output_layout_index_finish(index);
+		return;
+	}
+	index->xs_len = sort_unique(index->xs, index->xs_len);
+	index->ys_len = sort_unique(index->ys, index->ys_len);
+
+	size_t rows = index->ys_len - 1;
+	index->cells = calloc((index->xs_len - 1) * rows,
+		sizeof(struct wlr_output_layout_output *));
+	if (index->cells == NULL) {
+		goto error;
+	}
+
+	wl_list_for_each(l_output, &layout->outputs, link) {
+		struct wlr_box *box = output_layout_output_get_box(l_output);
+		if (wlr_box_empty(box)) {
+			continue;
+		}
+		// Edges of the box are always in the grid
+		size_t x1 = find_interval(index->xs, index->xs_len, box->x);
+		size_t y1 = find_interval(index->ys, index->ys_len, box->y);
+		for (size_t i = x1; index->xs[i] < box->x + box->width; i++) {
+			for (size_t j = y1; index->ys[j] < box->y + box->height; j++) {
+				struct wlr_output_layout_output **cell =
+					&index->cells[i * rows + j];
+				if (*cell == NULL) {
+					*cell = l_output;
+				}
+			}
+		}
+	}
+
+	return;
+
+error:
+	wlr_log_errno(WLR_ERROR, "Allocation failed");
+	output_layout_index_finish(index);
 }
 
 /**
@@ -98,6 +256,7 @@ static void output_layout_reconfigure(struct wlr_output_layout *layout) {
 	// in the layout
 	struct wlr_output_layout_output *l_output;
 	wl_list_for_each(l_output, &layout->outputs, link) {
+		output_layout_output_update_box(l_output);
 		if (l_output->state->auto_configured) {
 			continue;
 		}
@@ -120,11 +279,14 @@ static void output_layout_reconfigure(struct wlr_output_layout *layout) {
 			continue;
 		}
 		struct wlr_box *box = output_layout_output_get_box(l_output);
-		l_output->x = max_x;
-		l_output->y = max_x_y;
+		l_output->x = box->x = max_x;
+		l_output->y = box->y = max_x_y;
 		max_x += box->width;
 	}
 
+	output_layout_update_extents(layout);
+	output_layout_update_index(layout);
+
 	wlr_signal_emit_safe(&layout->events.change, layout);
 }
 
@@ -265,6 +427,19 @@ bool wlr_output_layout_intersects(struct wlr_output_layout *layout,
 
 struct wlr_output *wlr_output_layout_output_at(struct wlr_output_layout *layout,
 		double lx, double ly) {
+	struct wlr_output_layout_index *index = &layout->state->index;
+	if (index->cells != NULL) {
+		ssize_t i = find_interval(index->xs, index->xs_len, lx);
+		ssize_t j = find_interval(index->ys, index->ys_len, ly);
+		if (i < 0 || j < 0) {
+			return NULL;
+		}
+		struct wlr_output_layout_output *l_output =
+			index->cells[i * (index->ys_len - 1) + j];
+		return l_output != NULL ? l_output->output : NULL;
+	}
+
+	// The index couldn't be allocated
 	struct wlr_output_layout_output *l_output;
 	wl_list_for_each(l_output, &layout->outputs, link) {
 		struct wlr_box *box = output_layout_output_get_box(l_output);
@@ -322,6 +497,17 @@ void wlr_output_layout_closest_point(struct wlr_output_layout *layout,
 		return;
 	}
 
+	// Points inside the layout are their own closest point
+	if (reference == NULL && wlr_output_layout_output_at(layout, lx, ly)) {
+		if (dest_lx) {
+			*dest_lx = lx;
+		}
+		if (dest_ly) {
+			*dest_ly = ly;
+		}
+		return;
+	}
+
 	double min_x = 0, min_y = 0, min_distance = DBL_MAX;
 	struct wlr_output_layout_output *l_output;
 	wl_list_for_each(l_output, &layout->outputs, link) {
@@ -370,32 +556,6 @@ struct wlr_box *wlr_output_layout_get_box(
 		}
 	} else {
 		// layout extents
-		int min_x = 0, max_x = 0, min_y = 0, max_y = 0;
-		if (!wl_list_empty(&layout->outputs)) {
-			min_x = min_y = INT_MAX;
-			max_x = max_y = INT_MIN;
-			wl_list_for_each(l_output, &layout->outputs, link) {
-				struct wlr_box *box = output_layout_output_get_box(l_output);
-				if (box->x < min_x) {
-					min_x = box->x;
-				}
-				if (box->y < min_y) {
-					min_y = box->y;
-				}
-				if (box->x + box->width > max_x) {
-					max_x = box->x + box->width;
-				}
-				if (box->y + box->height > max_y) {
-					max_y = box->y + box->height;
-				}
-			}
-		}
-
-		layout->state->_box.x = min_x;
-		layout->state->_box.y = min_y;
-		layout->state->_box.width = max_x - min_x;
-		layout->state->_box.height = max_y - min_y;
-
 		return &layout->state->_box;
 	}
 
@@ -0,0 +1,263 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <wayland-server-core.h>
+#include <wlr/backend.h>
+#include <wlr/types/wlr_output_timing.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include "util/signal.h"
+#include "util/time.h"
+
+static void histogram_add(struct wlr_output_timing_histogram *histogram,
+		int64_t duration_ns) {
+	if (duration_ns < 0) {
+		duration_ns = 0;
+	}
+
+	size_t idx = histogram->samples_idx;
+	if (histogram->samples_len == WLR_OUTPUT_TIMING_HISTORY_LEN) {
+		// The oldest sample leaves the window
+		int64_t old_ms = histogram->samples[idx] / 1000000;
+		if (old_ms >= WLR_OUTPUT_TIMING_BUCKET_LEN) {
+			old_ms = WLR_OUTPUT_TIMING_BUCKET_LEN - 1;
+		}
+		histogram->buckets[old_ms]--;
+	} else {
+		histogram->samples_len++;
+	}
+
+	histogram->samples[idx] = duration_ns;
+	histogram->samples_idx = (idx + 1) % WLR_OUTPUT_TIMING_HISTORY_LEN;
+
+	int64_t ms = duration_ns / 1000000;
+	if (ms >= WLR_OUTPUT_TIMING_BUCKET_LEN) {
+		ms = WLR_OUTPUT_TIMING_BUCKET_LEN - 1;
+	}
+	histogram->buckets[ms]++;
+}
+
+static int compare_int64(const void *_a, const void *_b) {
+	const int64_t *a = _a, *b = _b;
+	return (*a > *b) - (*a < *b);
+}
+
+int64_t wlr_output_timing_histogram_percentile(
+		const struct wlr_output_timing_histogram *histogram, double percentile) {
+	size_t len = histogram->samples_len;
+	if (len == 0) {
+		return -1;
+	}
+
+	int64_t sorted[WLR_OUTPUT_TIMING_HISTORY_LEN];
+	memcpy(sorted, histogram->samples, len * sizeof(sorted[0]));
+	qsort(sorted, len, sizeof(sorted[0]), compare_int64);
+
+	if (percentile <= 0) {
+		return sorted[0];
+	}
+	size_t rank = (size_t)(percentile / 100 * len + 0.5);
+	if (rank < 1) {
+		rank = 1;
+	} else if (rank > len) {
+		rank = len;
+	}
+	return sorted[rank - 1];
+}
+
+static bool output_timing_get_commit(struct wlr_output_timing *output_timing,
+		uint32_t commit_seq, struct timespec *when) {
+	for (size_t i = 0; i < WLR_OUTPUT_TIMING_PENDING_LEN; i++) {
+		if (output_timing->pending[i].commit_seq == commit_seq &&
+				output_timing->pending[i].when.tv_sec != 0) {
+			*when = output_timing->pending[i].when;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void output_handle_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *output_timing =
+		wl_container_of(listener, output_timing, output_destroy);
+	wlr_output_timing_destroy(output_timing);
+}
+
+static void output_handle_frame(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *output_timing =
+		wl_container_of(listener, output_timing, output_frame);
+	clock_gettime(CLOCK_MONOTONIC, &output_timing->frame);
+	output_timing->frame_valid = true;
+}
+
+static void output_handle_precommit(struct wl_listener *listener,
+		void *data) {
+	struct wlr_output_timing *output_timing =
+		wl_container_of(listener, output_timing, output_precommit);
+	struct wlr_output_event_precommit *event = data;
+	struct wlr_output *output = output_timing->output;
+
+	if (!(output->pending.committed & WLR_OUTPUT_STATE_BUFFER)) {
+		return;
+	}
+
+	// Some backends send the present event before the commit event, record
+	// the commit beforehand. The entry is only kept if the commit succeeds,
+	// otherwise the next commit overwrites or drops it.
+	size_t idx = output_timing->pending_idx;
+	output_timing->pending[idx].commit_seq = output->commit_seq + 1;
+	output_timing->pending[idx].when = *event->when;
+}
+
+static void output_handle_commit(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *output_timing =
+		wl_container_of(listener, output_timing, output_commit);
+	struct wlr_output_event_commit *event = data;
+
+	if (!(event->committed & WLR_OUTPUT_STATE_BUFFER)) {
+		// Drop the entry left by a previous failed buffer commit, if any
+		memset(&output_timing->pending[output_timing->pending_idx], 0,
+			sizeof(output_timing->pending[0]));
+		return;
+	}
+
+	output_timing->pending_idx =
+		(output_timing->pending_idx + 1) % WLR_OUTPUT_TIMING_PENDING_LEN;
+
+	if (output_timing->frame_valid) {
+		struct timespec render;
+		timespec_sub(&render, event->when, &output_timing->frame);
+		histogram_add(&output_timing->render, timespec_to_nsec(&render));
+		output_timing->frame_valid = false;
+	}
+}
+
+static void output_handle_present(struct wl_listener *listener, void *data) {
+	struct wlr_output_timing *output_timing =
+		wl_container_of(listener, output_timing, output_present);
+	struct wlr_output_event_present *event = data;
+	struct wlr_output *output = output_timing->output;
+
+	output_timing->presented++;
+
+	// Commit times use CLOCK_MONOTONIC, they can only be compared to
+	// presentation times using the same clock
+	struct timespec commit_when;
+	bool has_commit = wlr_backend_get_presentation_clock(output->backend) ==
+		CLOCK_MONOTONIC && output_timing_get_commit(output_timing,
+		event->commit_seq, &commit_when);
+
+	if (has_commit) {
+		struct timespec latency;
+		timespec_sub(&latency, event->when, &commit_when);
+		histogram_add(&output_timing->latency, timespec_to_nsec(&latency));
+	}
+
+	int64_t period_ns = event->refresh;
+	if (period_ns <= 0 && output->refresh > 0) {
+		period_ns = 1000000000000 / output->refresh;
+	}
+
+	if (output_timing->present_valid) {
+		struct timespec interval;
+		timespec_sub(&interval, event->when, &output_timing->present);
+		int64_t interval_ns = timespec_to_nsec(&interval);
+
+		// If the frame was committed long after the previous one was
+		// presented, the output was idle: the interval isn't a frame time
+		bool idle = false;
+		if (has_commit && period_ns > 0) {
+			struct timespec since_present;
+			timespec_sub(&since_present, &commit_when, &output_timing->present);
+			idle = timespec_to_nsec(&since_present) > period_ns;
+		}
+
+		if (!idle) {
+			histogram_add(&output_timing->interval, interval_ns);
+			if (period_ns > 0) {
+				int64_t vblanks = (interval_ns + period_ns / 2) / period_ns;
+				if (vblanks > 1) {
+					output_timing->missed_vblanks += vblanks - 1;
+				}
+			}
+		}
+	}
+
+	output_timing->present = *event->when;
+	output_timing->present_valid = true;
+}
+
+struct wlr_output_timing *wlr_output_timing_create(struct wlr_output *output) {
+	struct wlr_output_timing *output_timing =
+		calloc(1, sizeof(struct wlr_output_timing));
+	if (output_timing == NULL) {
+		return NULL;
+	}
+
+	output_timing->output = output;
+	wl_signal_init(&output_timing->events.destroy);
+
+	wl_signal_add(&output->events.destroy, &output_timing->output_destroy);
+	output_timing->output_destroy.notify = output_handle_destroy;
+	wl_signal_add(&output->events.frame, &output_timing->output_frame);
+	output_timing->output_frame.notify = output_handle_frame;
+	wl_signal_add(&output->events.precommit, &output_timing->output_precommit);
+	output_timing->output_precommit.notify = output_handle_precommit;
+	wl_signal_add(&output->events.commit, &output_timing->output_commit);
+	output_timing->output_commit.notify = output_handle_commit;
+	wl_signal_add(&output->events.present, &output_timing->output_present);
+	output_timing->output_present.notify = output_handle_present;
+
+	return output_timing;
+}
+
+void wlr_output_timing_destroy(struct wlr_output_timing *output_timing) {
+	if (output_timing == NULL) {
+		return;
+	}
+	wlr_signal_emit_safe(&output_timing->events.destroy, output_timing);
+	wl_list_remove(&output_timing->output_destroy.link);
+	wl_list_remove(&output_timing->output_frame.link);
+	wl_list_remove(&output_timing->output_precommit.link);
+	wl_list_remove(&output_timing->output_commit.link);
+	wl_list_remove(&output_timing->output_present.link);
+	free(output_timing);
+}
+
+void wlr_output_timing_reset(struct wlr_output_timing *output_timing) {
+	memset(&output_timing->latency, 0, sizeof(output_timing->latency));
+	memset(&output_timing->render, 0, sizeof(output_timing->render));
+	memset(&output_timing->interval, 0, sizeof(output_timing->interval));
+	output_timing->presented = 0;
+	output_timing->missed_vblanks = 0;
+}
+
+static void histogram_log(const struct wlr_output_timing_histogram *histogram,
+		const char *name, enum wlr_log_importance verbosity) {
+	if (histogram->samples_len == 0) {
+		wlr_log(verbosity, "  %s: no samples", name);
+		return;
+	}
+
+	const double percentiles[] = { 0, 50, 90, 99, 100 };
+	double ms[sizeof(percentiles) / sizeof(percentiles[0])];
+	for (size_t i = 0; i < sizeof(percentiles) / sizeof(percentiles[0]); i++) {
+		ms[i] = wlr_output_timing_histogram_percentile(histogram,
+			percentiles[i]) / 1000000.0;
+	}
+	wlr_log(verbosity, "  %s: min %.2f ms, p50 %.2f ms, p90 %.2f ms, "
+		"p99 %.2f ms, max %.2f ms (%zu samples)", name,
+		ms[0], ms[1], ms[2], ms[3], ms[4], histogram->samples_len);
+}
+
+void wlr_output_timing_log(struct wlr_output_timing *output_timing,
+		enum wlr_log_importance verbosity) {
+	wlr_log(verbosity, "Output %s timings: %" PRIu64 " frames presented, "
+		"%" PRIu64 " missed vblanks", output_timing->output->name,
+		output_timing->presented, output_timing->missed_vblanks);
+	histogram_log(&output_timing->render, "render", verbosity);
+	histogram_log(&output_timing->latency, "commit to present", verbosity);
+	histogram_log(&output_timing->interval, "frame interval", verbosity);
+}
@@ -14,6 +14,7 @@
 #include "util/signal.h"
 
 #define SCREENCOPY_MANAGER_VERSION 3
+#define READBACK_POLL_INTERVAL_MS 1
 
 struct screencopy_damage {
 	struct wl_list link;
@@ -159,36 +160,56 @@ static void frame_destroy(struct wlr_screencopy_frame_v1 *frame) {
 	wl_list_remove(&frame->output_destroy.link);
 	wl_list_remove(&frame->output_enable.link);
 	wl_list_remove(&frame->buffer_destroy.link);
+	if (frame->readback_source != NULL) {
+		wl_event_source_remove(frame->readback_source);
+	}
+	wlr_render_readback_destroy(frame->readback);
 	// Make the frame resource inert
 	wl_resource_set_user_data(frame->resource, NULL);
 	client_unref(frame->client);
 	free(frame);
 }
 
-static void frame_send_damage(struct wlr_screencopy_frame_v1 *frame) {
+/**
+ * Take the damage accumulated since the client's last frame, if the frame was
+ * requested with damage.
+ */
+static bool frame_take_damage(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_box *box) {
 	if (!frame->with_damage) {
-		return;
+		return false;
 	}
 
 	struct screencopy_damage *damage =
 		screencopy_damage_get_or_create(frame->client, frame->output);
 	if (damage == NULL) {
-		return;
+		return false;
 	}
 
 	// TODO: send fine-grained damage events
 	struct pixman_box32 *damage_box =
 		pixman_region32_extents(&damage->damage);
 
-	int damage_x = damage_box->x1;
-	int damage_y = damage_box->y1;
-	int damage_width = damage_box->x2 - damage_box->x1;
-	int damage_height = damage_box->y2 - damage_box->y1;
+	box->x = damage_box->x1;
+	box->y = damage_box->y1;
+	box->width = damage_box->x2 - damage_box->x1;
+	box->height = damage_box->y2 - damage_box->y1;
+
+	pixman_region32_clear(&damage->damage);
+	return true;
+}
 
+static void frame_send_damage_box(struct wlr_screencopy_frame_v1 *frame,
+		const struct wlr_box *box) {
 	zwlr_screencopy_frame_v1_send_damage(frame->resource,
-		damage_x, damage_y, damage_width, damage_height);
+		box->x, box->y, box->width, box->height);
+}
 
-	pixman_region32_clear(&damage->damage);
+static void frame_send_damage(struct wlr_screencopy_frame_v1 *frame) {
+	struct wlr_box box;
+	if (frame_take_damage(frame, &box)) {
+		frame_send_damage_box(frame, &box);
+	}
 }
 
 static void frame_send_ready(struct wlr_screencopy_frame_v1 *frame,
@@ -200,6 +221,79 @@ static void frame_send_ready(struct wlr_screencopy_frame_v1 *frame,
 		tv_sec_hi, tv_sec_lo, when->tv_nsec);
 }
 
+static void frame_finish_readback(struct wlr_screencopy_frame_v1 *frame) {
+	struct wl_shm_buffer *shm_buffer = frame->shm_buffer;
+	int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
+
+	wl_shm_buffer_begin_access(shm_buffer);
+	void *data = wl_shm_buffer_get_data(shm_buffer);
+	uint32_t renderer_flags = 0;
+	bool ok = wlr_render_readback_copy(frame->readback, &renderer_flags,
+		stride, data);
+	uint32_t flags = renderer_flags & WLR_RENDERER_READ_PIXELS_Y_INVERT ?
+		ZWLR_SCREENCOPY_FRAME_V1_FLAGS_Y_INVERT : 0;
+	wl_shm_buffer_end_access(shm_buffer);
+
+	if (!ok) {
+		zwlr_screencopy_frame_v1_send_failed(frame->resource);
+		frame_destroy(frame);
+		return;
+	}
+
+	zwlr_screencopy_frame_v1_send_flags(frame->resource, flags);
+	if (frame->readback_has_damage) {
+		frame_send_damage_box(frame, &frame->readback_damage);
+	}
+	frame_send_ready(frame, &frame->readback_when);
+	frame_destroy(frame);
+}
+
+static int frame_handle_readback_fd(int fd, uint32_t mask, void *data) {
+	struct wlr_screencopy_frame_v1 *frame = data;
+	frame_finish_readback(frame);
+	return 0;
+}
+
+static int frame_handle_readback_timer(void *data) {
+	struct wlr_screencopy_frame_v1 *frame = data;
+	if (!wlr_render_readback_is_done(frame->readback)) {
+		wl_event_source_timer_update(frame->readback_source,
+			READBACK_POLL_INTERVAL_MS);
+		return 0;
+	}
+	frame_finish_readback(frame);
+	return 0;
+}
+
+static bool frame_start_readback(struct wlr_screencopy_frame_v1 *frame,
+		struct wlr_render_readback *readback, struct timespec *when) {
+	struct wl_client *client = wl_resource_get_client(frame->resource);
+	struct wl_event_loop *loop =
+		wl_display_get_event_loop(wl_client_get_display(client));
+
+	struct wl_event_source *source;
+	int fd = wlr_render_readback_get_fd(readback);
+	if (fd >= 0) {
+		source = wl_event_loop_add_fd(loop, fd, WL_EVENT_READABLE,
+			frame_handle_readback_fd, frame);
+	} else {
+		source = wl_event_loop_add_timer(loop,
+			frame_handle_readback_timer, frame);
+		if (source != NULL) {
+			wl_event_source_timer_update(source, READBACK_POLL_INTERVAL_MS);
+		}
+	}
+	if (source == NULL) {
+		wlr_log(WLR_ERROR, "Failed to add readback event source");
+		return false;
+	}
+
+	frame->readback = readback;
+	frame->readback_source = source;
+	frame->readback_when = *when;
+	return true;
+}
+
 static void frame_handle_output_precommit(struct wl_listener *listener,
 		void *_data) {
 	struct wlr_screencopy_frame_v1 *frame =
@@ -241,6 +335,21 @@ static void frame_handle_output_precommit(struct wl_listener *listener,
 	int32_t height = wl_shm_buffer_get_height(shm_buffer);
 	int32_t stride = wl_shm_buffer_get_stride(shm_buffer);
 
+	// Don't block the output commit while the GPU is busy: send the ready
+	// event once the copy has landed
+	struct wlr_render_readback *readback = wlr_renderer_read_pixels_async(
+		renderer, drm_format, width, height, x, y);
+	if (readback != NULL) {
+		if (frame_start_readback(frame, readback, event->when)) {
+			// Damage is tracked per commit, take it now and send it along
+			// with the ready event
+			frame->readback_has_damage =
+				frame_take_damage(frame, &frame->readback_damage);
+			return;
+		}
+		wlr_render_readback_destroy(readback);
+	}
+
 	wl_shm_buffer_begin_access(shm_buffer);
 	void *data = wl_shm_buffer_get_data(shm_buffer);
 	uint32_t renderer_flags = 0;
@@ -13,6 +13,7 @@
 #include "types/wlr_surface.h"
 #include "util/signal.h"
 #include "util/time.h"
+#include "util/trace.h"
 
 #define CALLBACK_VERSION 1
 #define SURFACE_VERSION 4
@@ -423,6 +424,9 @@ static void surface_commit_state(struct wlr_surface *surface,
 		struct wlr_surface_state *next) {
 	assert(next->cached_state_locks == 0);
 
+	trace_begin("surface_commit", "surface",
+		wl_resource_get_id(surface->resource));
+
 	bool invalid_buffer = next->committed & WLR_SURFACE_STATE_BUFFER;
 
 	surface->sx += next->dx;
@@ -456,6 +460,8 @@ static void surface_commit_state(struct wlr_surface *surface,
 	}
 
 	wlr_signal_emit_safe(&surface->events.commit, surface);
+
+	trace_end("surface_commit");
 }
 
 static void surface_commit_pending(struct wlr_surface *surface) {
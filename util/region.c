@@ -1,7 +1,9 @@
 #include <assert.h>
 #include <math.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <wlr/types/wlr_box.h>
 #include <wlr/util/region.h>
 
@@ -186,6 +188,142 @@ void wlr_region_rotated_bounds(pixman_region32_t *dst, pixman_region32_t *src,
 	free(dst_rects);
 }
 
+static int64_t box_area(const pixman_box32_t *box) {
+	return (int64_t)(box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+static pixman_box32_t box_union(const pixman_box32_t *a,
+		const pixman_box32_t *b) {
+	return (pixman_box32_t){
+		.x1 = a->x1 < b->x1 ? a->x1 : b->x1,
+		.y1 = a->y1 < b->y1 ? a->y1 : b->y1,
+		.x2 = a->x2 > b->x2 ? a->x2 : b->x2,
+		.y2 = a->y2 > b->y2 ? a->y2 : b->y2,
+	};
+}
+
+// Rectangles are sorted top-to-bottom, left-to-right, so good merge
+// candidates are close to each other in the list. Only look at a few
+// neighbours when searching for the best pair to merge.
+#define SIMPLIFY_MERGE_WINDOW 8
+// The best pair search is repeated for each merge, so it is quadratic in the
+// number of rectangles. Larger regions first go through a single greedy pass.
+#define SIMPLIFY_MAX_SEARCH_RECTS 64
+
+static int64_t merge_waste(const pixman_box32_t *a, const pixman_box32_t *b) {
+	pixman_box32_t merged = box_union(a, b);
+	return box_area(&merged) - box_area(a) - box_area(b);
+}
+
+/**
+ * Merge each rectangle into the previous one while within the waste budget,
+ * in a single pass. Returns the new number of rectangles.
+ */
+static int simplify_greedy(pixman_box32_t *rects, int nrects,
+		int64_t *waste_budget) {
+	int n = 1;
+	for (int i = 1; i < nrects; ++i) {
+		pixman_box32_t *last = &rects[n - 1];
+		int64_t waste = merge_waste(last, &rects[i]);
+		if (waste <= *waste_budget) {
+			if (waste > 0) {
+				*waste_budget -= waste;
+			}
+			*last = box_union(last, &rects[i]);
+		} else {
+			rects[n++] = rects[i];
+		}
+	}
+	return n;
+}
+
+/**
+ * Repeatedly merge the pair of neighbouring rectangles adding the least area,
+ * while within the waste budget or while there are more than max_rects
+ * rectangles. Returns the new number of rectangles.
+ */
+static int simplify_best_pairs(pixman_box32_t *rects, int nrects,
+		int max_rects, int64_t *waste_budget) {
+	while (nrects > 1) {
+		// Find the pair of rectangles whose bounding box adds the least area
+		int best_i = -1, best_j = -1;
+		int64_t best_waste = INT64_MAX;
+		for (int i = 0; i < nrects - 1; ++i) {
+			int end = i + 1 + SIMPLIFY_MERGE_WINDOW;
+			if (end > nrects) {
+				end = nrects;
+			}
+			for (int j = i + 1; j < end; ++j) {
+				int64_t waste = merge_waste(&rects[i], &rects[j]);
+				if (waste < best_waste) {
+					best_waste = waste;
+					best_i = i;
+					best_j = j;
+				}
+			}
+		}
+
+		// Merge for free while within budget, or if there are too many
+		// rectangles regardless of the cost
+		bool too_many = max_rects > 0 && nrects > max_rects;
+		if (!too_many && best_waste > *waste_budget) {
+			break;
+		}
+		if (best_waste > 0) {
+			*waste_budget -= best_waste;
+		}
+
+		rects[best_i] = box_union(&rects[best_i], &rects[best_j]);
+		memmove(&rects[best_j], &rects[best_j + 1],
+			(nrects - best_j - 1) * sizeof(pixman_box32_t));
+		--nrects;
+	}
+	return nrects;
+}
+
+void wlr_region_simplify(pixman_region32_t *dst, pixman_region32_t *src,
+		int max_rects, float max_waste) {
+	int nrects;
+	pixman_box32_t *src_rects = pixman_region32_rectangles(src, &nrects);
+	if (nrects <= 1) {
+		pixman_region32_copy(dst, src);
+		return;
+	}
+
+	pixman_box32_t *rects = malloc(nrects * sizeof(pixman_box32_t));
+	if (rects == NULL) {
+		pixman_region32_copy(dst, src);
+		return;
+	}
+	memcpy(rects, src_rects, nrects * sizeof(pixman_box32_t));
+
+	int64_t total_area = 0;
+	for (int i = 0; i < nrects; ++i) {
+		total_area += box_area(&rects[i]);
+	}
+	int64_t waste_budget = max_waste > 0 ? total_area * max_waste : 0;
+
+	// Keep the cost linear for regions with many rectangles, whatever is left
+	// above max_rects afterwards is replaced with the extents below
+	if (nrects > SIMPLIFY_MAX_SEARCH_RECTS) {
+		nrects = simplify_greedy(rects, nrects, &waste_budget);
+	}
+	if (nrects <= SIMPLIFY_MAX_SEARCH_RECTS) {
+		nrects = simplify_best_pairs(rects, nrects, max_rects, &waste_budget);
+	}
+
+	pixman_region32_fini(dst);
+	pixman_region32_init_rects(dst, rects, nrects);
+	free(rects);
+
+	// Overlapping rectangles may be split again into bands by pixman
+	if (max_rects > 0 && pixman_region32_n_rects(dst) > max_rects) {
+		pixman_box32_t extents = *pixman_region32_extents(dst);
+		pixman_region32_fini(dst);
+		pixman_region32_init_with_extents(dst, &extents);
+	}
+}
+
 static void region_confine(pixman_region32_t *region, double x1, double y1, double x2,
 		double y2, double *x2_out, double *y2_out, pixman_box32_t box) {
 	double x_clamped = fmax(fmin(x2, box.x2 - 1), box.x1);
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <errno.h>
 #include <fcntl.h>
 #include <string.h>
@@ -53,3 +54,39 @@ int allocate_shm_file(size_t size) {
 
 	return fd;
 }
+
+int allocate_sealed_shm_file(const void *data, size_t size) {
+#if defined(MFD_ALLOW_SEALING) && defined(F_ADD_SEALS)
+	int fd = memfd_create("wlroots", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd < 0) {
+		return -1;
+	}
+
+	const char *ptr = data;
+	while (size > 0) {
+		ssize_t n = write(fd, ptr, size);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			goto error;
+		}
+		ptr += n;
+		size -= n;
+	}
+
+	if (fcntl(fd, F_ADD_SEALS,
+			F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL) != 0) {
+		goto error;
+	}
+
+	return fd;
+
+error:
+	close(fd);
+	return -1;
+#else
+	errno = ENOSYS;
+	return -1;
+#endif
+}
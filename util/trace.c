@@ -0,0 +1,124 @@
+#define _POSIX_C_SOURCE 200809L
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include <wlr/util/trace.h>
+#include "util/time.h"
+#include "util/trace.h"
+
+#if HAS_TRACING
+
+#define TRACE_EVENTS_LEN (1 << 16)
+
+struct trace_event {
+	int64_t timestamp_ns;
+	const char *name;
+	const char *arg_name; // may be NULL
+	int64_t arg;
+	char phase;
+};
+
+bool trace_enabled = false;
+
+// circular queue of recorded events
+static struct trace_event *trace_events = NULL;
+static size_t trace_events_idx = 0, trace_events_len = 0;
+
+void trace_record(char phase, const char *name, const char *arg_name,
+		int64_t arg) {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	struct trace_event *event = &trace_events[trace_events_idx];
+	event->timestamp_ns = timespec_to_nsec(&now);
+	event->name = name;
+	event->arg_name = arg_name;
+	event->arg = arg;
+	event->phase = phase;
+
+	trace_events_idx = (trace_events_idx + 1) % TRACE_EVENTS_LEN;
+	if (trace_events_len < TRACE_EVENTS_LEN) {
+		trace_events_len++;
+	}
+}
+
+bool wlr_trace_set_enabled(bool enabled) {
+	if (enabled && trace_events == NULL) {
+		trace_events = calloc(TRACE_EVENTS_LEN, sizeof(struct trace_event));
+		if (trace_events == NULL) {
+			wlr_log_errno(WLR_ERROR, "Allocation failed");
+			return false;
+		}
+	}
+	trace_enabled = enabled;
+	return true;
+}
+
+void wlr_trace_clear(void) {
+	trace_events_idx = 0;
+	trace_events_len = 0;
+}
+
+bool wlr_trace_dump(const char *path) {
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		wlr_log_errno(WLR_ERROR, "Failed to open %s", path);
+		return false;
+	}
+
+	int pid = getpid();
+	fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+	size_t start = (trace_events_idx + TRACE_EVENTS_LEN - trace_events_len) %
+		TRACE_EVENTS_LEN;
+	for (size_t i = 0; i < trace_events_len; i++) {
+		const struct trace_event *event =
+			&trace_events[(start + i) % TRACE_EVENTS_LEN];
+		// Timestamps are in microseconds
+		fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%" PRId64 ".%03d,"
+			"\"pid\":%d,\"tid\":%d", i > 0 ? "," : "", event->name,
+			event->phase, event->timestamp_ns / 1000,
+			(int)(event->timestamp_ns % 1000), pid, pid);
+		if (event->phase == 'i') {
+			// Instant events are scoped to the thread
+			fprintf(f, ",\"s\":\"t\"");
+		}
+		if (event->arg_name != NULL) {
+			fprintf(f, ",\"args\":{\"%s\":%" PRId64 "}", event->arg_name,
+				event->arg);
+		}
+		fprintf(f, "}");
+	}
+
+	fprintf(f, "\n]}\n");
+
+	if (fclose(f) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to write %s", path);
+		return false;
+	}
+	return true;
+}
+
+#else
+
+bool wlr_trace_set_enabled(bool enabled) {
+	if (enabled) {
+		wlr_log(WLR_ERROR, "wlroots has been built without tracing support");
+		return false;
+	}
+	return true;
+}
+
+void wlr_trace_clear(void) {
+	// No-op
+}
+
+bool wlr_trace_dump(const char *path) {
+	wlr_log(WLR_ERROR, "wlroots has been built without tracing support");
+	return false;
+}
+
+#endif